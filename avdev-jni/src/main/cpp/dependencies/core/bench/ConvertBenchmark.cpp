@@ -0,0 +1,615 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelFormatConverter.h"
+#include "AVdevException.h"
+#include "CpuInfo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define AVDEV_HAS_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AVDEV_HAS_TSC
+#endif
+
+using namespace avdev;
+
+/*
+ * Measures the frame conversion throughput of the PixelFormatConverter.
+ *
+ * Usage: avdev-bench-convert [--suite] [--verify] [--csv] [--sizes WxH,WxH,...] [--min-time MS]
+ *                            [--size WxH] [--output WxH] [--format FOURCC] [--output-format FOURCC]
+ *                            [--frames N] [--threads N,N,...]
+ *                            [--rotate 0|90|180|270] [--mirror 0|1] [--matrix 601|709] [--range limited|full]
+ *
+ * With --suite every registered single-step conversion is measured at each of
+ * the sizes, otherwise only the conversion given by --format and --output-format.
+ * Without --frames each measurement runs for at least --min-time milliseconds.
+ *
+ * With --verify nothing is measured. Every conversion, scaled conversions
+ * included, is run with each SIMD level the CPU supports and compared
+ * byte by byte with the scalar conversion, on odd widths and padded rows.
+ */
+
+struct Size
+{
+	unsigned width;
+	unsigned height;
+};
+
+struct Options
+{
+	bool suite = false;
+	bool verify = false;
+	bool csv = false;
+	std::vector<Size> sizes = { { 320, 240 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+	unsigned width = 1920;
+	unsigned height = 1080;
+	unsigned outputWidth = 0;
+	unsigned outputHeight = 0;
+	PixelFormat format = PixelFormat::YUYV;
+	PixelFormat outputFormat = PixelFormat::RGB24;
+	unsigned frames = 0;
+	double minTime = 200;
+	std::vector<unsigned> threads = { 1, 2, 4 };
+	Orientation orientation;
+	YuvMatrix matrix = YuvMatrix::BT601;
+	YuvRange range = YuvRange::Limited;
+};
+
+struct Result
+{
+	unsigned frames;
+	double frameTime;
+	double nsPerPixel;
+	double gigabytesPerSecond;
+	/* Negative if the platform has no cycle counter. */
+	double cyclesPerPixel;
+};
+
+static PixelFormat ParseFormat(const std::string & fcc)
+{
+	if (fcc.size() != 4) {
+		throw AVdevException("Invalid pixel format: %s", fcc.c_str());
+	}
+
+	return static_cast<PixelFormat>(FOURCC(fcc[0], fcc[1], fcc[2], fcc[3]));
+}
+
+static std::vector<unsigned> ParseList(const std::string & list)
+{
+	std::vector<unsigned> values;
+	std::size_t start = 0;
+
+	while (start < list.size()) {
+		std::size_t end = list.find(',', start);
+
+		if (end == std::string::npos) {
+			end = list.size();
+		}
+
+		values.push_back(static_cast<unsigned>(std::stoul(list.substr(start, end - start))));
+
+		start = end + 1;
+	}
+
+	return values;
+}
+
+static Rotation ParseRotation(const std::string & degrees)
+{
+	if (degrees == "0") {
+		return Rotation::None;
+	}
+	if (degrees == "90") {
+		return Rotation::Rotate90;
+	}
+	if (degrees == "180") {
+		return Rotation::Rotate180;
+	}
+	if (degrees == "270") {
+		return Rotation::Rotate270;
+	}
+
+	throw AVdevException("Invalid rotation: %s", degrees.c_str());
+}
+
+static YuvMatrix ParseMatrix(const std::string & matrix)
+{
+	if (matrix == "601") {
+		return YuvMatrix::BT601;
+	}
+	if (matrix == "709") {
+		return YuvMatrix::BT709;
+	}
+
+	throw AVdevException("Invalid matrix: %s", matrix.c_str());
+}
+
+static YuvRange ParseRange(const std::string & range)
+{
+	if (range == "limited") {
+		return YuvRange::Limited;
+	}
+	if (range == "full") {
+		return YuvRange::Full;
+	}
+
+	throw AVdevException("Invalid range: %s", range.c_str());
+}
+
+static Size ParseSize(const std::string & size)
+{
+	Size value;
+
+	if (std::sscanf(size.c_str(), "%ux%u", &value.width, &value.height) != 2 || value.width == 0 || value.height == 0) {
+		throw AVdevException("Invalid size: %s", size.c_str());
+	}
+
+	return value;
+}
+
+static std::vector<Size> ParseSizeList(const std::string & list)
+{
+	std::vector<Size> sizes;
+	std::size_t start = 0;
+
+	while (start < list.size()) {
+		std::size_t end = list.find(',', start);
+
+		if (end == std::string::npos) {
+			end = list.size();
+		}
+
+		sizes.push_back(ParseSize(list.substr(start, end - start)));
+
+		start = end + 1;
+	}
+
+	return sizes;
+}
+
+static Options ParseOptions(int argc, char ** argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--suite") {
+			options.suite = true;
+			continue;
+		}
+		if (arg == "--verify") {
+			options.verify = true;
+			continue;
+		}
+		if (arg == "--csv") {
+			options.csv = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			throw AVdevException("Missing value for %s", arg.c_str());
+		}
+
+		std::string value = argv[++i];
+
+		if (arg == "--size") {
+			Size size = ParseSize(value);
+			options.width = size.width;
+			options.height = size.height;
+		}
+		else if (arg == "--sizes") {
+			options.sizes = ParseSizeList(value);
+		}
+		else if (arg == "--output") {
+			Size size = ParseSize(value);
+			options.outputWidth = size.width;
+			options.outputHeight = size.height;
+		}
+		else if (arg == "--format") {
+			options.format = ParseFormat(value);
+		}
+		else if (arg == "--output-format") {
+			options.outputFormat = ParseFormat(value);
+		}
+		else if (arg == "--frames") {
+			options.frames = static_cast<unsigned>(std::stoul(value));
+		}
+		else if (arg == "--min-time") {
+			options.minTime = std::stod(value);
+		}
+		else if (arg == "--threads") {
+			options.threads = ParseList(value);
+		}
+		else if (arg == "--rotate") {
+			options.orientation = Orientation(ParseRotation(value), options.orientation.isMirrored());
+		}
+		else if (arg == "--mirror") {
+			options.orientation = Orientation(options.orientation.getRotation(), value == "1");
+		}
+		else if (arg == "--matrix") {
+			options.matrix = ParseMatrix(value);
+		}
+		else if (arg == "--range") {
+			options.range = ParseRange(value);
+		}
+		else {
+			throw AVdevException("Unknown option: %s", arg.c_str());
+		}
+	}
+
+	return options;
+}
+
+/* Time stamp counter ticks. These run at the nominal clock rate, not the current core clock. */
+static std::uint64_t ReadCycleCounter()
+{
+#if defined(AVDEV_HAS_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static Result Measure(PixelFormatConverter & converter, const Options & options, const std::uint8_t * src,
+	std::uint8_t * dest, unsigned pixels, std::size_t bytes)
+{
+	// Warm up the caches and the thread pool.
+	converter.convert(src, dest);
+
+	unsigned frames = options.frames;
+
+	if (frames == 0) {
+		auto start = std::chrono::steady_clock::now();
+
+		converter.convert(src, dest);
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		frames = static_cast<unsigned>(std::min(options.minTime / std::max(elapsed.count(), 1e-3), 1e6));
+		frames = std::max(frames, 3u);
+	}
+
+	std::uint64_t startCycles = ReadCycleCounter();
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < frames; i++) {
+		converter.convert(src, dest);
+	}
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	std::uint64_t cycles = ReadCycleCounter() - startCycles;
+
+	double totalPixels = static_cast<double>(pixels) * frames;
+
+	Result result;
+	result.frames = frames;
+	result.frameTime = elapsed.count() / frames / 1e6;
+	result.nsPerPixel = elapsed.count() / totalPixels;
+	result.gigabytesPerSecond = static_cast<double>(bytes) * frames / elapsed.count();
+	result.cyclesPerPixel = cycles != 0 ? cycles / totalPixels : -1;
+
+	return result;
+}
+
+static void PrintHeader(const Options & options)
+{
+	if (options.csv) {
+		std::printf("source,destination,width,height,output_width,output_height,threads,frames,"
+			"ms_per_frame,ns_per_pixel,gb_per_s,cycles_per_pixel,speedup\n");
+	}
+	else {
+		std::printf("BT.%s %s range, rotation %d, mirror %d\n",
+			options.matrix == YuvMatrix::BT709 ? "709" : "601",
+			options.range == YuvRange::Full ? "full" : "limited",
+			static_cast<int>(options.orientation.getRotation()) * 90, options.orientation.isMirrored() ? 1 : 0);
+	}
+}
+
+static void PrintResult(const Options & options, const PictureFormat & srcFormat, const PictureFormat & dstFormat,
+	unsigned threads, const Result & result, double speedup)
+{
+	std::string src = PixelFormatToString(srcFormat.getPixelFormat());
+	std::string dst = PixelFormatToString(dstFormat.getPixelFormat());
+
+	if (options.csv) {
+		std::printf("%s,%s,%u,%u,%u,%u,%u,%u,%.4f,%.4f,%.3f,", src.c_str(), dst.c_str(),
+			srcFormat.getWidth(), srcFormat.getHeight(), dstFormat.getWidth(), dstFormat.getHeight(),
+			threads, result.frames, result.frameTime, result.nsPerPixel, result.gigabytesPerSecond);
+
+		if (result.cyclesPerPixel >= 0) {
+			std::printf("%.3f", result.cyclesPerPixel);
+		}
+
+		std::printf(",%.3f\n", speedup);
+	}
+	else {
+		char cycles[32] = "n/a";
+
+		if (result.cyclesPerPixel >= 0) {
+			std::snprintf(cycles, sizeof(cycles), "%.2f", result.cyclesPerPixel);
+		}
+
+		std::printf("%s -> %s %ux%u -> %ux%u threads %2u: %8.3f ms/frame  %6.3f ns/px  %6.2f GB/s  %6s cycles/px  speedup %.2fx\n",
+			src.c_str(), dst.c_str(), srcFormat.getWidth(), srcFormat.getHeight(),
+			dstFormat.getWidth(), dstFormat.getHeight(), threads, result.frameTime, result.nsPerPixel,
+			result.gigabytesPerSecond, cycles, speedup);
+	}
+
+	std::fflush(stdout);
+}
+
+/* Measures one conversion with each of the thread counts. */
+static void Run(const Options & options, const PictureFormat & srcFormat, const PictureFormat & dstFormat)
+{
+	unsigned pixels = srcFormat.getWidth() * srcFormat.getHeight();
+	std::size_t srcSize = GetFrameSize(srcFormat);
+	std::size_t dstSize = GetFrameSize(dstFormat);
+
+	std::vector<std::uint8_t> src(srcSize);
+	std::vector<std::uint8_t> dest(dstSize);
+
+	std::mt19937 random(42);
+
+	for (std::uint8_t & value : src) {
+		value = static_cast<std::uint8_t>(random());
+	}
+
+	double baseline = 0;
+
+	for (unsigned threads : options.threads) {
+		PixelFormatConverter converter;
+		converter.init(srcFormat, dstFormat, ColorSpace(options.matrix, options.range));
+		converter.setThreadCount(threads);
+		converter.setOrientation(options.orientation);
+
+		Result result = Measure(converter, options, src.data(), dest.data(), pixels, srcSize + dstSize);
+
+		if (baseline == 0) {
+			baseline = result.frameTime;
+		}
+
+		PrintResult(options, srcFormat, dstFormat, threads, result, baseline / result.frameTime);
+	}
+}
+
+/* A SIMD level selected with CpuInfo::setFeatureMask(), including the lower levels. */
+struct SimdLevel
+{
+	const char * name;
+	unsigned mask;
+};
+
+/* Converts a frame with rows stride bytes apart, the destination starts filled with a marker. */
+static std::vector<std::uint8_t> ConvertFrame(const PictureFormat & srcFormat, const PictureFormat & dstFormat,
+	ColorSpace colorSpace, const std::vector<std::uint8_t> & src, std::size_t srcStride, std::size_t dstStride)
+{
+	std::vector<std::uint8_t> dest(GetFrameSize(dstFormat, dstStride), 0xA5);
+
+	PixelFormatConverter converter;
+	converter.init(srcFormat, dstFormat, colorSpace);
+	converter.convert(MakeFrameView(srcFormat, src.data(), srcStride), MakeFrameView(dstFormat, dest.data(), dstStride));
+
+	return dest;
+}
+
+/* Row stride with padding, even so that planar chroma rows get half of it. */
+static std::size_t PaddedStride(const PictureFormat & format)
+{
+	std::size_t rowSize = GetPlaneRowSize(format, 0);
+
+	return rowSize + (rowSize & 1) + 38;
+}
+
+/*
+ * Compares one conversion of each SIMD level with the scalar one, returns the
+ * number of mismatches. Conversions not supported at the size are skipped.
+ */
+static unsigned VerifyConversion(const std::vector<SimdLevel> & levels, const PictureFormat & srcFormat,
+	const PictureFormat & dstFormat, ColorSpace colorSpace, bool padded, std::mt19937 & random, unsigned & checks)
+{
+	const std::size_t srcStride = padded ? PaddedStride(srcFormat) : 0;
+	const std::size_t dstStride = padded ? PaddedStride(dstFormat) : 0;
+
+	std::vector<std::uint8_t> src(GetFrameSize(srcFormat, srcStride));
+
+	for (std::uint8_t & value : src) {
+		value = static_cast<std::uint8_t>(random());
+	}
+
+	CpuInfo::setFeatureMask(0);
+
+	std::vector<std::uint8_t> expected;
+
+	try {
+		expected = ConvertFrame(srcFormat, dstFormat, colorSpace, src, srcStride, dstStride);
+	}
+	catch (AVdevException &) {
+		// Not supported at this size, by any level.
+		return 0;
+	}
+
+	unsigned failures = 0;
+
+	checks++;
+
+	for (const SimdLevel & level : levels) {
+		CpuInfo::setFeatureMask(level.mask);
+
+		std::vector<std::uint8_t> dest = ConvertFrame(srcFormat, dstFormat, colorSpace, src, srcStride, dstStride);
+
+		if (dest != expected) {
+			std::size_t offset = std::mismatch(dest.begin(), dest.end(), expected.begin()).first - dest.begin();
+
+			std::printf("FAIL %s -> %s %ux%u -> %ux%u %s BT.%s %s range, %s rows: byte %zu is %u, expected %u\n",
+				PixelFormatToString(srcFormat.getPixelFormat()).c_str(),
+				PixelFormatToString(dstFormat.getPixelFormat()).c_str(),
+				srcFormat.getWidth(), srcFormat.getHeight(), dstFormat.getWidth(), dstFormat.getHeight(), level.name,
+				colorSpace.getMatrix() == YuvMatrix::BT709 ? "709" : "601",
+				colorSpace.getRange() == YuvRange::Full ? "full" : "limited",
+				padded ? "padded" : "packed", offset, dest[offset], expected[offset]);
+
+			failures++;
+		}
+	}
+
+	return failures;
+}
+
+/* Verifies all conversions of all SIMD levels, returns the number of mismatches. */
+static unsigned Verify()
+{
+	const SimdLevel allLevels[] = {
+		{ "SSE2", static_cast<unsigned>(CpuFeature::SSE2) },
+		{ "SSSE3", static_cast<unsigned>(CpuFeature::SSE2) | static_cast<unsigned>(CpuFeature::SSSE3) },
+		{ "AVX2", static_cast<unsigned>(CpuFeature::SSE2) | static_cast<unsigned>(CpuFeature::SSSE3) |
+			static_cast<unsigned>(CpuFeature::AVX2) },
+		{ "NEON", static_cast<unsigned>(CpuFeature::NEON) }
+	};
+
+	// Widths around the vector sizes of all levels, odd ones end packed 4:2:2 rows in a partial
+	// macro-pixel, and a height with an odd chroma row. Frames have their exact size, an
+	// AddressSanitizer build catches reads past the rows.
+	const unsigned widths[] = { 1, 2, 3, 7, 15, 16, 17, 31, 33, 47, 63, 65, 95, 129, 641 };
+	const unsigned height = 7;
+
+	const unsigned features = CpuInfo::getFeatures();
+	std::vector<SimdLevel> levels;
+
+	for (const SimdLevel & level : allLevels) {
+		if ((features & level.mask) == level.mask) {
+			levels.push_back(level);
+		}
+	}
+
+	std::printf("Verifying SIMD levels:");
+
+	for (const SimdLevel & level : levels) {
+		std::printf(" %s", level.name);
+	}
+
+	std::printf("%s\n", levels.empty() ? " none" : "");
+
+	std::vector<std::pair<PixelFormat, PixelFormat>> conversions = PixelFormatConverter().getConversions();
+	std::vector<std::pair<PixelFormat, PixelFormat>> scaled;
+
+	for (const auto & conversion : conversions) {
+		const PixelFormat dst = conversion.second;
+
+		if (ScaledYUV_RGB::supportsFormat(conversion.first) &&
+			(dst == PixelFormat::RGB24 || dst == PixelFormat::BGR24 || dst == PixelFormat::RGB32))
+		{
+			scaled.push_back(conversion);
+		}
+	}
+
+	std::mt19937 random(42);
+	unsigned checks = 0;
+	unsigned failures = 0;
+
+	for (YuvMatrix matrix : { YuvMatrix::BT601, YuvMatrix::BT709 }) {
+		for (YuvRange range : { YuvRange::Limited, YuvRange::Full }) {
+			ColorSpace colorSpace(matrix, range);
+
+			for (unsigned width : widths) {
+				for (bool padded : { false, true }) {
+					for (const auto & conversion : conversions) {
+						failures += VerifyConversion(levels, PictureFormat(width, height, conversion.first),
+							PictureFormat(width, height, conversion.second), colorSpace, padded, random, checks);
+					}
+
+					for (const auto & conversion : scaled) {
+						failures += VerifyConversion(levels, PictureFormat(width, height, conversion.first),
+							PictureFormat((width + 1) / 2, (height + 1) / 2, conversion.second), colorSpace, padded, random, checks);
+					}
+				}
+			}
+		}
+	}
+
+	CpuInfo::setFeatureMask(~0U);
+
+	// Larger output sizes are rejected, instead of planning the downscaler.
+	for (const auto & conversion : scaled) {
+		try {
+			PixelFormatConverter().init(PictureFormat(64, 48, conversion.first), PictureFormat(64, 96, conversion.second));
+
+			std::printf("Upscaling %s -> %s not rejected\n", PixelFormatToString(conversion.first).c_str(),
+				PixelFormatToString(conversion.second).c_str());
+			failures++;
+		}
+		catch (AVdevException &) {
+		}
+
+		checks++;
+	}
+
+	std::printf("%u conversions verified, %u mismatches\n", checks, failures);
+
+	return failures;
+}
+
+int main(int argc, char ** argv)
+{
+	try {
+		Options options = ParseOptions(argc, argv);
+
+		if (options.verify) {
+			return Verify() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		PrintHeader(options);
+
+		if (options.suite) {
+			std::vector<std::pair<PixelFormat, PixelFormat>> conversions = PixelFormatConverter().getConversions();
+
+			for (const auto & conversion : conversions) {
+				for (const Size & size : options.sizes) {
+					Run(options, PictureFormat(size.width, size.height, conversion.first),
+						PictureFormat(size.width, size.height, conversion.second));
+				}
+			}
+		}
+		else {
+			if (options.outputWidth == 0 || options.outputHeight == 0) {
+				options.outputWidth = options.width;
+				options.outputHeight = options.height;
+			}
+
+			Run(options, PictureFormat(options.width, options.height, options.format),
+				PictureFormat(options.outputWidth, options.outputHeight, options.outputFormat));
+		}
+	}
+	catch (std::exception & ex) {
+		std::fprintf(stderr, "%s\n", ex.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoOutputStream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace avdev;
+
+/*
+ * Checks the frame delivery of the VideoOutputStream to its own and attached
+ * sinks, without a capture device.
+ *
+ * Usage: avdev-check-stream
+ */
+
+class CountingSink : public VideoSink
+{
+	public:
+		void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format)
+		{
+			frames++;
+		}
+
+		void writeVideoFrame(const PVideoFrame & frame)
+		{
+			frames++;
+		}
+
+		unsigned frames = 0;
+};
+
+/* Writes frames as a capture device would, the device callbacks do nothing. */
+class TestStream : public VideoOutputStream
+{
+	public:
+		TestStream(PVideoSink sink) :
+			VideoOutputStream(sink)
+		{
+		}
+
+		void open(const PictureFormat & format)
+		{
+			setOutputFormat(format);
+			initFramePool(GetFrameSize(format));
+			startDelivery();
+		}
+
+		void write(const PictureFormat & format, std::uint32_t sequence)
+		{
+			std::vector<std::uint8_t> data(GetFrameSize(format));
+
+			VideoFrameInfo info;
+			info.sequence = sequence;
+
+			writeVideoFrame(data.data(), data.size(), format, info);
+		}
+
+		/* Hands the frame to the own sink without a copy, as a dmabuf capture would. */
+		void writeShared(const PictureFormat & format, std::uint32_t sequence)
+		{
+			setOwnSinkShared(true);
+
+			std::vector<std::uint8_t> data(GetFrameSize(format));
+
+			VideoFrameInfo info;
+			info.sequence = sequence;
+
+			sink->writeVideoFrame(data.data(), data.size(), format);
+
+			if (hasAttachedSinks(format)) {
+				PVideoFrame frame = acquireVideoFrame();
+
+				if (frame) {
+					frame->setFormat(format, data.size());
+					frame->setInfo(info);
+
+					writeVideoFrame(std::move(frame));
+				}
+			}
+		}
+
+		void close()
+		{
+			stopDelivery();
+		}
+
+	protected:
+		void openInternal() {}
+		void closeInternal() {}
+		void startInternal() {}
+		void stopInternal() {}
+};
+
+static bool CheckAttachedSameFormat(unsigned queueSize)
+{
+	PictureFormat format(64, 48, PixelFormat::RGB24);
+
+	auto own = std::make_shared<CountingSink>();
+	auto attached = std::make_shared<CountingSink>();
+
+	TestStream stream(own);
+	stream.setDeliveryQueueSize(queueSize);
+	stream.attachSink(attached, format);
+	stream.open(format);
+
+	for (std::uint32_t i = 0; i < 3; i++) {
+		stream.write(format, i);
+	}
+
+	stream.close();
+
+	return own->frames == 3 && attached->frames == 3;
+}
+
+static bool CheckAttachedSharedFormat(unsigned queueSize)
+{
+	PictureFormat format(64, 48, PixelFormat::RGB24);
+
+	auto own = std::make_shared<CountingSink>();
+	auto attached = std::make_shared<CountingSink>();
+
+	TestStream stream(own);
+	stream.setDeliveryQueueSize(queueSize);
+	stream.attachSink(attached, format);
+	stream.open(format);
+
+	for (std::uint32_t i = 0; i < 3; i++) {
+		stream.writeShared(format, i);
+	}
+
+	stream.close();
+
+	// The copies for the attached sink are not written to the own sink again.
+	return own->frames == 3 && attached->frames == 3;
+}
+
+static bool CheckFrameLargerThanPool()
+{
+	PictureFormat format(64, 48, PixelFormat::RGB24);
+	PictureFormat larger(128, 96, PixelFormat::RGB24);
+
+	auto own = std::make_shared<CountingSink>();
+	auto attached = std::make_shared<CountingSink>();
+
+	TestStream stream(own);
+	stream.attachSink(attached, larger);
+	stream.open(format);
+
+	for (std::uint32_t i = 0; i < 3; i++) {
+		stream.write(larger, i);
+	}
+
+	stream.close();
+
+	// The pooled frames don't grow, the frames are written without a copy.
+	return own->frames == 3;
+}
+
+int main()
+{
+	struct Check
+	{
+		std::string name;
+		std::function<bool()> run;
+	};
+
+	std::vector<Check> checks = {
+		{ "attached sink of the own format, without delivery queue", []() { return CheckAttachedSameFormat(0); } },
+		{ "attached sink of the own format, with delivery queue", []() { return CheckAttachedSameFormat(4); } },
+		{ "attached sink of the own format, shared frames", []() { return CheckAttachedSharedFormat(0); } },
+		{ "attached sink of the own format, shared frames with delivery queue", []() { return CheckAttachedSharedFormat(4); } },
+		{ "frame larger than the pooled frames", CheckFrameLargerThanPool },
+	};
+
+	int failed = 0;
+
+	for (const Check & check : checks) {
+		bool passed = false;
+
+		try {
+			passed = check.run();
+		}
+		catch (std::exception & ex) {
+			std::fprintf(stderr, "%s: %s\n", check.name.c_str(), ex.what());
+		}
+
+		std::printf("%s: %s\n", passed ? "PASS" : "FAIL", check.name.c_str());
+
+		if (!passed) {
+			failed++;
+		}
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_COLOR_SPACE_H_
+#define AVDEV_CORE_COLOR_SPACE_H_
+
+namespace avdev
+{
+	/* Matrix used to encode RGB as YCbCr. */
+	enum class YuvMatrix
+	{
+		BT601,
+		BT709
+	};
+
+	/* Quantization range of the Y, Cb and Cr samples. */
+	enum class YuvRange
+	{
+		Limited,	/* Y in [16, 235], Cb and Cr in [16, 240] */
+		Full		/* All samples in [0, 255] */
+	};
+
+	/* Describes how YUV frames are converted to RGB. */
+	class ColorSpace
+	{
+		public:
+			ColorSpace(YuvMatrix matrix = YuvMatrix::BT601, YuvRange range = YuvRange::Limited);
+
+			bool operator== (const ColorSpace & other) const;
+			bool operator!= (const ColorSpace & other) const;
+
+			YuvMatrix getMatrix() const;
+			YuvRange getRange() const;
+
+		private:
+			YuvMatrix matrix;
+			YuvRange range;
+	};
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_CPU_INFO_H_
+#define AVDEV_CORE_CPU_INFO_H_
+
+namespace avdev
+{
+	enum class CpuFeature : unsigned
+	{
+		SSE2  = 1 << 0,
+		SSSE3 = 1 << 1,
+		AVX2  = 1 << 2,
+		NEON  = 1 << 3
+	};
+
+	namespace CpuInfo
+	{
+		/* Returns the bitmask of CpuFeature flags usable on this machine. */
+		unsigned getFeatures();
+
+		bool hasFeature(CpuFeature feature);
+
+		/*
+		 * Restricts the reported features to the given mask. Used to force
+		 * the scalar or a lower SIMD path, e.g. for verification.
+		 */
+		void setFeatureMask(unsigned mask);
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_FRAME_DELIVERY_QUEUE_H_
+#define AVDEV_CORE_FRAME_DELIVERY_QUEUE_H_
+
+#include "VideoFrame.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace avdev
+{
+	/* Which frame to give up, when the consumer falls behind. */
+	enum class FrameDropPolicy
+	{
+		/* Replace the oldest waiting frame, keeps the latency low. */
+		DropOldest,
+
+		/* Discard the incoming frame, keeps the waiting frames. */
+		DropNewest
+	};
+
+	/*
+	 * Hands pooled frames from a producer, e.g. a capture thread, to a
+	 * delivery thread calling the frame handler, so that a slow handler does
+	 * not hold up capturing. Producer and consumer claim the queue slots with
+	 * atomic state transitions, only an idle delivery thread is woken up
+	 * through a condition variable.
+	 *
+	 * This is no head/tail ring: to drop the oldest frame the producer takes
+	 * back a waiting slot, which the consumer may be claiming at the same
+	 * time. Each slot has its own state and sequence instead, which also
+	 * keeps push() safe for producers on several threads, e.g. decoders.
+	 */
+	class FrameDeliveryQueue
+	{
+		public:
+			/* Called with one frame at a time on the delivery thread. */
+			using FrameHandler = std::function<void(const PVideoFrame & frame)>;
+
+			/* Up to capacity frames wait for delivery, in addition to the one being delivered. */
+			FrameDeliveryQueue(unsigned capacity, FrameDropPolicy policy, FrameHandler handler);
+
+			/* Delivers the waiting frames and stops the delivery thread. */
+			~FrameDeliveryQueue();
+
+			FrameDeliveryQueue(const FrameDeliveryQueue &) = delete;
+			FrameDeliveryQueue & operator=(const FrameDeliveryQueue &) = delete;
+
+			/*
+			 * Queues the frame. Returns false, if the frame was dropped, or
+			 * replaced a waiting frame, since the queue is full.
+			 */
+			bool push(PVideoFrame frame);
+
+			/* Number of frames dropped since the consumer fell behind. */
+			std::uint64_t getDroppedFrames() const;
+
+		private:
+			enum SlotState : int {
+				FREE, WRITING, READY, READING
+			};
+
+			struct Slot
+			{
+				PVideoFrame frame;
+				std::atomic<std::uint64_t> sequence;
+				std::atomic<int> state;
+
+				Slot() : sequence(0), state(FREE) {}
+			};
+
+			/* Returns the ready slot with the lowest sequence, or null. */
+			Slot * findOldest(std::uint64_t * sequence);
+
+			/* Claims the oldest ready slot by moving it to the given state. */
+			Slot * claimOldest(int state);
+
+			void run();
+
+		private:
+			std::vector<std::unique_ptr<Slot>> slots;
+			std::thread worker;
+
+			FrameHandler handler;
+			FrameDropPolicy policy;
+
+			std::atomic<std::uint64_t> nextSequence;
+			std::atomic<std::uint64_t> droppedFrames;
+
+			std::mutex mutex;
+			std::condition_variable cond;
+			std::atomic<bool> sleeping;
+			std::atomic<bool> running;
+	};
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_FRAME_VIEW_H_
+#define AVDEV_CORE_FRAME_VIEW_H_
+
+#include "PictureFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace avdev
+{
+	/*
+	 * Plane pointers and row strides in bytes of a video frame. Planar YUV has
+	 * its planes in Y, U, V order, independent of their order in memory, and
+	 * semi-planar YUV has the interleaved chroma in plane 1. Unused planes are
+	 * null. A view does not own the memory it points to.
+	 */
+	template <typename T>
+	struct BasicFrameView
+	{
+		enum { MaxPlanes = 3 };
+
+		BasicFrameView() :
+			data(),
+			stride()
+		{
+		}
+
+		/* Allows to pass a writable view where a read-only view is expected. */
+		template <typename U>
+		BasicFrameView(const BasicFrameView<U> & other)
+		{
+			for (int i = 0; i < MaxPlanes; i++) {
+				data[i] = other.data[i];
+				stride[i] = other.stride[i];
+			}
+		}
+
+		T * data[MaxPlanes];
+		std::ptrdiff_t stride[MaxPlanes];
+	};
+
+	using FrameView = BasicFrameView<std::uint8_t>;
+	using ConstFrameView = BasicFrameView<const std::uint8_t>;
+
+	/* Number of planes of an uncompressed pixel format. */
+	int GetPlaneCount(PixelFormat format);
+
+	/* Size in bytes of one row of the given plane without padding. */
+	std::size_t GetPlaneRowSize(const PictureFormat & format, int plane);
+
+	/* Number of rows of the given plane. */
+	unsigned GetPlaneHeight(const PictureFormat & format, int plane);
+
+	/*
+	 * Size in bytes of a frame stored in one buffer, see MakeFrameView(). A
+	 * stride of 0 selects rows without padding.
+	 */
+	std::size_t GetFrameSize(const PictureFormat & format, std::size_t stride = 0);
+
+	/*
+	 * Describes a frame stored in one buffer, as the single-planar V4L2 formats
+	 * are. Rows of the first plane are stride bytes apart, a stride of 0 selects
+	 * rows without padding. Planar chroma rows have half the stride of the luma
+	 * rows and semi-planar chroma rows the same stride, as defined by V4L2.
+	 */
+	FrameView MakeFrameView(const PictureFormat & format, std::uint8_t * buffer, std::size_t stride = 0);
+	ConstFrameView MakeFrameView(const PictureFormat & format, const std::uint8_t * buffer, std::size_t stride = 0);
+}
+
+#endif
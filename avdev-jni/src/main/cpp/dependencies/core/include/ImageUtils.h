@@ -17,9 +17,9 @@
 #ifndef AVDEV_CORE_IMAGE_UTILS_H_
 #define AVDEV_CORE_IMAGE_UTILS_H_
 
-#include <cstdlib>
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <cstring>
 
 namespace avdev
 {
@@ -27,17 +27,18 @@ namespace avdev
 	{
 		static void flipVertically(std::uint8_t * pixels, const size_t width, const size_t height, const unsigned bytesPerPixel)
 		{
+			if (height < 2) {
+				return;
+			}
+
 			const size_t stride = width * bytesPerPixel;
-			std::uint8_t * row = static_cast<std::uint8_t *>(std::malloc(stride));
 			std::uint8_t * low = pixels;
 			std::uint8_t * high = &pixels[(height - 1) * stride];
 
+			// Swap in place, converters can flip for free with Orientation::flipVertical().
 			for (; low < high; low += stride, high -= stride) {
-				std::memcpy(row, low, stride);
-				std::memcpy(low, high, stride);
-				std::memcpy(high, row, stride);
+				std::swap_ranges(low, low + stride, high);
 			}
-			std::free(row);
 		}
 	}
 }
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_ORIENTATION_H_
+#define AVDEV_CORE_ORIENTATION_H_
+
+namespace avdev
+{
+	/* Clockwise rotation of a video frame. */
+	enum class Rotation
+	{
+		None,
+		Rotate90,
+		Rotate180,
+		Rotate270
+	};
+
+	/*
+	 * Orientation of a video frame. The frame is mirrored horizontally before
+	 * it is rotated, e.g. a vertical flip is a mirrored 180 degree rotation.
+	 */
+	class Orientation
+	{
+		public:
+			Orientation(Rotation rotation = Rotation::None, bool mirror = false);
+
+			static Orientation flipVertical();
+
+			bool operator== (const Orientation & other) const;
+			bool operator!= (const Orientation & other) const;
+
+			Rotation getRotation() const;
+			bool isMirrored() const;
+
+			/* Returns true, if frames are left untouched. */
+			bool isIdentity() const;
+
+			/* Returns true, if width and height of the frame are swapped. */
+			bool swapsDimensions() const;
+
+		private:
+			Rotation rotation;
+			bool mirror;
+	};
+}
+
+#endif
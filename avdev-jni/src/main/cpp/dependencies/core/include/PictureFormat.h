@@ -43,6 +43,7 @@ namespace avdev
 		I420    = FOURCC('I', '4', '2', '0'),	/* 12  YUV 4:2:0      */
 		YUYV    = FOURCC('Y', 'U', 'Y', 'V'),	/* 16  YUV 4:2:2      */
 		UYVY    = FOURCC('U', 'Y', 'V', 'Y'),	/* 16  YUV 4:2:2      */
+		YVYU    = FOURCC('Y', 'V', 'Y', 'U'),	/* 16  YVU 4:2:2      */
 		YUV422P = FOURCC('I', '4', '2', '2'),	/* 16  YVU 422 planar */
 		YUV411P = FOURCC('I', '4', '1', '1'),	/* 16  YVU 411 planar */
 		Y41P    = FOURCC('Y', '4', '1', 'P'),	/* 12  YUV 4:1:1      */
@@ -74,6 +75,21 @@ namespace avdev
 		return ToFccString(fcc);
 	}
 
+	/* Compressed formats have no pixel layout, e.g. no rows or planes. */
+	inline bool IsCompressedFormat(PixelFormat format)
+	{
+		switch (format) {
+			case PixelFormat::JPEG:
+			case PixelFormat::MPEG:
+			case PixelFormat::MJPG:
+			case PixelFormat::DV:
+			case PixelFormat::WNVA:
+				return true;
+			default:
+				return false;
+		}
+	}
+
 	class PictureFormat
 	{
 		public:
@@ -17,11 +17,19 @@
 #ifndef AVDEV_CORE_PIXEL_FORMAT_CONVERTER_H_
 #define AVDEV_CORE_PIXEL_FORMAT_CONVERTER_H_
 
+#include "ColorSpace.h"
+#include "FrameView.h"
+#include "Orientation.h"
 #include "PictureFormat.h"
+#include "PixelFormatKernels.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace avdev
 {
@@ -30,34 +38,261 @@ namespace avdev
 		public:
 			virtual ~Converter() {}
 
-			virtual void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength) = 0;
+			/*
+			 * Called once before conversion, e.g. to select the fastest kernel.
+			 * YUV sources are converted with the matrix and range of the color space.
+			 */
+			virtual void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace) {}
 
-		protected:
-			inline std::uint8_t clip(int color);
+			/* Converts a whole frame. The views may have padded rows. */
+			virtual void convert(const ConstFrameView & src, const FrameView & dest) = 0;
+
+			/*
+			 * Converters that are able to convert a band of rows independently
+			 * of the rest of the frame can be run slice-parallel.
+			 */
+			virtual bool supportsRows() const { return false; }
+
+			/*
+			 * Sets the number of bands converted at the same time with convertRows(),
+			 * e.g. to allocate scratch memory for each band up front.
+			 */
+			virtual void setBandCount(unsigned bands) {}
+
+			/*
+			 * Converts the rows [firstRow, firstRow + rows) of the source frame. The
+			 * first row is written to dest, the following rows destStride bytes
+			 * apart. A negative stride writes the rows bottom-up. Concurrent calls
+			 * pass distinct bands below the band count.
+			 */
+			virtual void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band) {}
+
+			/*
+			 * True if the converted frame is the start of the source frame. The
+			 * source frame can then be used as is, without calling convert().
+			 */
+			virtual bool isZeroCopy() const { return false; }
+	};
+
+	/* Converts packed 4:2:2 YUV with the given sample layout to RGB24. */
+	template <typename Layout>
+	class Packed422_RGB24 : public Converter
+	{
+		public:
+			Packed422_RGB24();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+		private:
+			kernels::Packed422Kernel kernel;
+			kernels::YuvCoefficients coeffs;
+			unsigned width;
+			unsigned height;
+	};
+
+	using YUYV_RGB24 = Packed422_RGB24<kernels::YUYVLayout>;
+	using YVYU_RGB24 = Packed422_RGB24<kernels::YVYULayout>;
+	using UYVY_RGB24 = Packed422_RGB24<kernels::UYVYLayout>;
+
+	/*
+	 * Converts planar (I420, YV12, YVU420, YUV422P) and semi-planar (NV12, NV21)
+	 * YUV to RGB24, BGR24 or RGB32.
+	 */
+	class PlanarYUV_RGB : public Converter
+	{
+		public:
+			PlanarYUV_RGB();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+		private:
+			kernels::PlanarKernel kernel;
+			kernels::YuvCoefficients coeffs;
+			PixelFormat srcPixelFormat;
+			unsigned width;
+			unsigned height;
+	};
+
+	/*
+	 * Converts packed 4:2:2, planar and semi-planar YUV to a smaller RGB24,
+	 * BGR24 or RGB32 frame. Each output row is box-filtered in the YUV domain
+	 * and passed to the planar row kernel, the full-size RGB frame is never
+	 * materialized.
+	 */
+	class ScaledYUV_RGB : public Converter
+	{
+		public:
+			ScaledYUV_RGB();
+
+			/* Returns true, if frames of the pixel format can be scaled. */
+			static bool supportsFormat(PixelFormat format);
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void setBandCount(unsigned bands);
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+		private:
+			/* Source sample range [begin, end) of one output sample. */
+			struct Span
+			{
+				unsigned begin;
+				unsigned end;
+			};
+
+			/*
+			 * Location of the samples of one component. Interleaved components
+			 * share the same plane and differ by their offset within the group.
+			 */
+			struct Plane
+			{
+				int index;
+				unsigned offset;
+				unsigned rowSize;
+				unsigned step;
+				unsigned height;
+			};
+
+			/* Column sums and reduced samples of the components of one band. */
+			struct Scratch
+			{
+				std::vector<std::uint16_t> sums[3];
+				std::vector<std::uint8_t> samples[3];
+			};
+
+			static std::vector<Span> createSpans(unsigned srcSize, unsigned dstSize);
+			static void accumulateRows(const std::uint8_t * src, std::ptrdiff_t stride, unsigned rowSize, Span rows,
+				std::uint16_t * sums);
+			/* Averages the spans of the first count samples, step sums apart. */
+			static void reduceRow(const std::uint16_t * sums, unsigned step, unsigned count, const std::vector<Span> & spans,
+				unsigned rowCount, std::uint8_t * dest);
+
+			kernels::PlanarKernel kernel;
+			kernels::YuvCoefficients coeffs;
+			Plane planes[3];
+			unsigned vShift;
+			unsigned srcHeight;
+			unsigned dstWidth;
+			std::vector<Span> lumaSpans;
+			std::vector<Span> chromaSpans;
+			std::vector<Span> rowSpans;
+			std::vector<Scratch> scratch;
+	};
+
+	/*
+	 * Extracts the luma of packed 4:2:2, planar and semi-planar YUV as GREY.
+	 * Planar and semi-planar frames start with the luma plane, which is copied
+	 * or handed through without copying.
+	 */
+	class YUV_Grey : public Converter
+	{
+		public:
+			YUV_Grey();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+			bool isZeroCopy() const;
+
+		private:
+			/* Null for formats with a luma plane. */
+			kernels::LumaKernel kernel;
+			unsigned width;
+			unsigned height;
 	};
 
-	class YUYV_RGB24 : public Converter
+	/*
+	 * Copies frames unchanged, used when only the orientation or the row padding
+	 * is changed. Only single-plane formats can be converted in row bands.
+	 */
+	class FrameCopy : public Converter
 	{
 		public:
-			void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength);
+			FrameCopy();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+			bool isZeroCopy() const;
+
+		private:
+			PictureFormat format;
 	};
 
-	class YVYU_RGB24 : public Converter
+	/* Reorders the components of 24 and 32-bit RGB formats, 32-bit output gets an opaque alpha byte. */
+	template <typename SrcOrder, typename DstOrder>
+	class RGB_Swizzle : public Converter
 	{
 		public:
-			void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength);
+			RGB_Swizzle();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			bool supportsRows() const;
+			void convertRows(const ConstFrameView & src, std::uint8_t * dest, std::ptrdiff_t destStride,
+				unsigned firstRow, unsigned rows, unsigned band);
+
+		private:
+			static void swizzleRow(const std::uint8_t * src, std::uint8_t * dest, unsigned pixels);
+
+			unsigned width;
+			unsigned height;
 	};
 
-	class UYVY_RGB24 : public Converter
+	/*
+	 * Repacks packed 4:2:2, planar and semi-planar YUV as I420 or NV12. Vertically
+	 * subsampled chroma is the rounded average of two rows.
+	 */
+	class YUV_YUV420 : public Converter
 	{
 		public:
-			void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength);
+			YUV_YUV420();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+		private:
+			kernels::LumaKernel kernel;
+			PixelFormat srcPixelFormat;
+			PixelFormat dstPixelFormat;
+			unsigned width;
+			unsigned height;
 	};
 
 	class RGB565_RGB24 : public Converter
 	{
 		public:
-			void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength);
+			RGB565_RGB24();
+
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace);
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+		private:
+			unsigned width;
+			unsigned height;
 	};
 
 	class PixelFormatConverter : public Converter
@@ -65,16 +300,100 @@ namespace avdev
 		public:
 			PixelFormatConverter();
 
-			void init(PictureFormat srcFormat, PictureFormat dstFormat);
+			/*
+			 * The default color space is BT.601 limited range, as used by most
+			 * webcams. Frames are scaled down to the size of dstFormat, a larger
+			 * size is rejected.
+			 */
+			void init(PictureFormat srcFormat, PictureFormat dstFormat, ColorSpace colorSpace = ColorSpace());
+
+			void convert(const ConstFrameView & src, const FrameView & dest);
+
+			/* Converts a frame without row padding to an output frame without row padding. */
+			void convert(const std::uint8_t * src, std::uint8_t * dest);
 
-			void convert(const std::uint8_t * src, std::uint8_t * dest, int frameLength);
+			/*
+			 * Splits each frame into row bands which are converted on the shared
+			 * thread pool. A thread count of 1 converts on the calling thread.
+			 */
+			void setThreadCount(unsigned threads);
+			unsigned getThreadCount() const;
+
+			/*
+			 * Mirrors and rotates the frames while they are converted. With a
+			 * rotation of 90 or 270 degrees the output format has the width and
+			 * height of the requested format swapped. Throws, if the output
+			 * format is not one of whole pixels, e.g. packed 4:2:2 or planar.
+			 */
+			void setOrientation(Orientation orientation);
+			Orientation getOrientation() const;
 
 			PictureFormat const& getOutputFormat() const;
+			ColorSpace getColorSpace() const;
+
+			/*
+			 * True if a source frame without row padding can be used as output
+			 * without calling convert().
+			 */
+			bool isZeroCopy() const;
+
+			/* The source and destination formats of all single-step conversions. */
+			std::vector<std::pair<PixelFormat, PixelFormat>> getConversions() const;
+
+		private:
+			/* A registered conversion and its estimated cost in ns per pixel. */
+			struct ConverterEntry
+			{
+				std::shared_ptr<Converter> converter;
+				float cost;
+			};
+
+			/* A conversion preceding the last one, writing to an intermediate buffer. */
+			struct Stage
+			{
+				std::shared_ptr<Converter> converter;
+				PictureFormat format;
+				FrameView view;
+			};
+
+			void addConverter(PixelFormat srcFormat, PixelFormat dstFormat, std::shared_ptr<Converter> converter, float cost);
+
+			/*
+			 * Finds the cheapest chain of registered converters. With downscaling
+			 * the scaler is the first conversion. Returns the formats of the chain,
+			 * starting with the source format, or an empty list.
+			 */
+			std::vector<PixelFormat> planChain(PixelFormat srcFormat, PixelFormat dstFormat, bool scale) const;
+
+			/* Calls func(band, firstRow, rows) for the row bands of a frame, on the thread pool. */
+			template <typename Func>
+			void forEachBand(const Func & func);
+
+			void convertOriented(const ConstFrameView & src, const FrameView & dest, unsigned band,
+				unsigned firstRow, unsigned rows);
+
+			/* Throws, if the conversion can't write the frames with the orientation. */
+			void checkOrientation(const Orientation & orientation) const;
+
+			/* Sizes the scratch memory of the converters and oriented conversions for each band. */
+			void updateBandBuffers();
+			void updateOutputFormat();
 
 		private:
-			std::map<std::pair<PixelFormat, PixelFormat>, std::shared_ptr<Converter>> convMap;
+			std::map<std::pair<PixelFormat, PixelFormat>, ConverterEntry> convMap;
 			std::shared_ptr<Converter> converter;
+			std::vector<Stage> stages;
+			std::vector<std::uint8_t> stageBuffers[2];
+			PictureFormat srcFormat;
 			PictureFormat dstFormat;
+			PictureFormat outputFormat;
+			Orientation orientation;
+			ColorSpace colorSpace;
+			unsigned height;
+			unsigned threads;
+
+			std::vector<std::uint8_t> bandBuffer;
+			std::size_t bandBufferSize;
 	};
 }
 
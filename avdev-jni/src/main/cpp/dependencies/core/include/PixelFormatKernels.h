@@ -0,0 +1,244 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_PIXEL_FORMAT_KERNELS_H_
+#define AVDEV_CORE_PIXEL_FORMAT_KERNELS_H_
+
+#include "ColorSpace.h"
+
+#include <cstdint>
+
+namespace avdev
+{
+	namespace kernels
+	{
+		/*
+		 * YUV to RGB coefficients in 8-bit fixed point, for zero-centred chroma.
+		 * Every term is truncated on its own, which maps to a single high-half
+		 * multiply per vector in the SIMD kernels:
+		 *
+		 *   Y' = ((Y * yScale) >> 8) + yBias
+		 *   R  = Y' + ((V * vr) >> 8)
+		 *   G  = Y' - ((U * ug) >> 8) - ((V * vg) >> 8)
+		 *   B  = Y' + ((U * ub) >> 8)
+		 *
+		 * The bias removes the luma offset of limited range. The result is within
+		 * 3 of the exact conversion.
+		 */
+		struct YuvCoefficients
+		{
+			std::int16_t yScale;
+			std::int16_t yBias;
+			std::int16_t vr;
+			std::int16_t ug;
+			std::int16_t vg;
+			std::int16_t ub;
+		};
+
+		constexpr std::int16_t ToFixed8(double value)
+		{
+			return static_cast<std::int16_t>(value * 256 + 0.5);
+		}
+
+		/* Derives the coefficients from the luma weights Kr and Kb of a matrix. */
+		constexpr YuvCoefficients MakeYuvCoefficients(double kr, double kb, YuvRange range)
+		{
+			const double kg = 1 - kr - kb;
+			const double ys = (range == YuvRange::Full) ? 1.0 : 255.0 / 219.0;
+			const double cs = (range == YuvRange::Full) ? 1.0 : 255.0 / 224.0;
+			const double offset = (range == YuvRange::Full) ? 0.0 : 16.0;
+
+			return {
+				ToFixed8(ys),
+				static_cast<std::int16_t>(-offset * ys),
+				ToFixed8(2 * (1 - kr) * cs),
+				ToFixed8(2 * (1 - kb) * kb / kg * cs),
+				ToFixed8(2 * (1 - kr) * kr / kg * cs),
+				ToFixed8(2 * (1 - kb) * cs)
+			};
+		}
+
+		/* Indexed by YuvMatrix and YuvRange. */
+		constexpr YuvCoefficients YuvCoefficientTable[2][2] = {
+			{ MakeYuvCoefficients(0.299, 0.114, YuvRange::Limited), MakeYuvCoefficients(0.299, 0.114, YuvRange::Full) },
+			{ MakeYuvCoefficients(0.2126, 0.0722, YuvRange::Limited), MakeYuvCoefficients(0.2126, 0.0722, YuvRange::Full) }
+		};
+
+		static_assert(YuvCoefficientTable[0][0].vr == 409 && YuvCoefficientTable[0][0].ub == 516,
+			"Unexpected BT.601 coefficients");
+
+		inline const YuvCoefficients & GetYuvCoefficients(ColorSpace colorSpace)
+		{
+			return YuvCoefficientTable[static_cast<int>(colorSpace.getMatrix())][static_cast<int>(colorSpace.getRange())];
+		}
+
+		/* Converts a run of pixels, the pixel count must be even. */
+		using Packed422Kernel = void (*)(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs);
+
+		/*
+		 * Converts one row of planar or semi-planar YUV. The chroma pointers
+		 * address the chroma row belonging to the luma row. For semi-planar
+		 * input both point into the interleaved row, at their first sample.
+		 */
+		using PlanarKernel = void (*)(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs);
+
+		/* Extracts the luma samples of a run of packed 4:2:2 pixels, the pixel count must be even. */
+		using LumaKernel = void (*)(const std::uint8_t * src, std::uint8_t * dest, int pixels);
+
+		/* Byte positions of the samples within a 4 byte packed 4:2:2 macro-pixel. */
+		struct YUYVLayout { enum { Y0 = 0, U = 1, Y1 = 2, V = 3 }; };
+		struct YVYULayout { enum { Y0 = 0, V = 1, Y1 = 2, U = 3 }; };
+		struct UYVYLayout { enum { U = 0, Y0 = 1, V = 2, Y1 = 3 }; };
+
+		/* Chroma sample organisation of planar and semi-planar formats. */
+		enum class ChromaLayout
+		{
+			Planar,		/* Separate U and V planes, e.g. I420, YV12 */
+			UV,			/* Interleaved U/V plane, NV12 */
+			VU			/* Interleaved V/U plane, NV21 */
+		};
+
+		/* Byte positions of the components of the RGB output formats. */
+		struct RGB24Order { enum { R = 0, G = 1, B = 2, Size = 3 }; };
+		struct BGR24Order { enum { B = 0, G = 1, R = 2, Size = 3 }; };
+		struct RGB32Order { enum { R = 0, G = 1, B = 2, Size = 4 }; };
+		struct BGR32Order { enum { B = 0, G = 1, R = 2, Size = 4 }; };
+
+		inline std::uint8_t clip(int color)
+		{
+			return (color > 0xFF) ? 0xFF : ((color < 0) ? 0 : color);
+		}
+
+		/* Chroma contributions of zero-centred U and V samples. */
+		inline void ChromaTerms_C(int u, int v, const YuvCoefficients & coeffs, int & u1, int & rg, int & v1)
+		{
+			u1 = (u * coeffs.ub) >> 8;
+			rg = ((u * coeffs.ug) >> 8) + ((v * coeffs.vg) >> 8);
+			v1 = (v * coeffs.vr) >> 8;
+		}
+
+		/* Writes one pixel, 32-bit formats get an opaque alpha byte. */
+		template <typename Order>
+		inline void StorePixel_C(std::uint8_t * dest, int y, int u1, int rg, int v1, const YuvCoefficients & coeffs)
+		{
+			int yt = ((y * coeffs.yScale) >> 8) + coeffs.yBias;
+
+			dest[Order::R] = clip(yt + v1);
+			dest[Order::G] = clip(yt - rg);
+			dest[Order::B] = clip(yt + u1);
+
+			if (Order::Size == 4) {
+				dest[3] = 0xFF;
+			}
+		}
+
+		/*
+		 * Reference implementations. The SIMD kernels must produce exactly the
+		 * same output and use them to process the remaining tail pixels.
+		 */
+		template <typename Layout>
+		inline void Packed422ToRGB24_C(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs)
+		{
+			int u1, rg, v1;
+
+			for (int j = 0; j + 1 < pixels; j += 2) {
+				ChromaTerms_C(src[Layout::U] - 128, src[Layout::V] - 128, coeffs, u1, rg, v1);
+
+				StorePixel_C<RGB24Order>(dest, src[Layout::Y0], u1, rg, v1, coeffs);
+				StorePixel_C<RGB24Order>(dest + 3, src[Layout::Y1], u1, rg, v1, coeffs);
+
+				src += 4;
+				dest += 6;
+			}
+		}
+
+		template <ChromaLayout Chroma, typename Order>
+		inline void PlanarToRGB_C(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs)
+		{
+			const int step = (Chroma == ChromaLayout::Planar) ? 1 : 2;
+			int u1, rg, v1;
+
+			for (int j = 0; j < width; j += 2) {
+				ChromaTerms_C(*u - 128, *v - 128, coeffs, u1, rg, v1);
+
+				StorePixel_C<Order>(dest, y[0], u1, rg, v1, coeffs);
+				dest += Order::Size;
+
+				if (j + 1 < width) {
+					StorePixel_C<Order>(dest, y[1], u1, rg, v1, coeffs);
+					dest += Order::Size;
+				}
+
+				y += 2;
+				u += step;
+				v += step;
+			}
+		}
+
+		template <typename Layout>
+		inline void Packed422ToGrey_C(const std::uint8_t * src, std::uint8_t * dest, int pixels)
+		{
+			for (int j = 0; j + 1 < pixels; j += 2) {
+				dest[0] = src[Layout::Y0];
+				dest[1] = src[Layout::Y1];
+
+				src += 4;
+				dest += 2;
+			}
+		}
+
+		template <typename Layout>
+		void Packed422ToRGB24_SSE2(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs);
+
+		template <typename Layout>
+		void Packed422ToRGB24_SSSE3(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs);
+
+		template <typename Layout>
+		void Packed422ToRGB24_AVX2(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs);
+
+		template <typename Layout>
+		void Packed422ToRGB24_NEON(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_SSE2(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_SSSE3(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_AVX2(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_NEON(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs);
+
+		template <typename Layout>
+		void Packed422ToGrey_SSE2(const std::uint8_t * src, std::uint8_t * dest, int pixels);
+
+		template <typename Layout>
+		void Packed422ToGrey_AVX2(const std::uint8_t * src, std::uint8_t * dest, int pixels);
+
+		template <typename Layout>
+		void Packed422ToGrey_NEON(const std::uint8_t * src, std::uint8_t * dest, int pixels);
+	}
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_PIXEL_FORMAT_KERNELS_X86_H_
+#define AVDEV_CORE_PIXEL_FORMAT_KERNELS_X86_H_
+
+#include "PixelFormatKernels.h"
+
+#include <emmintrin.h>
+
+/*
+ * SSE2 building blocks shared by the x86 kernels. The functions have internal
+ * linkage, since the including translation units are compiled with different
+ * instruction set flags and must not share one out-of-line copy.
+ */
+namespace avdev
+{
+	namespace kernels
+	{
+		namespace
+		{
+			/*
+			 * Splits 16 packed 4:2:2 pixels into 16 luma bytes and 8 zero-centred
+			 * U and V samples in the high byte of 16-bit words. Flipping the sign
+			 * bit subtracts the chroma bias.
+			 */
+			template <typename Layout>
+			inline void Unpack422_SSE2(const std::uint8_t * src, __m128i & y, __m128i & u, __m128i & v)
+			{
+				const __m128i mask = _mm_set1_epi16(0x00FF);
+				const __m128i high = _mm_set1_epi16(-0x100);
+				const __m128i sign = _mm_set1_epi16(-0x8000);
+
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+				__m128i c;
+
+				if (Layout::Y0 == 0) {
+					y = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+					c = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+				}
+				else {
+					y = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+					c = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+				}
+
+				__m128i first = _mm_xor_si128(_mm_slli_epi16(c, 8), sign);
+				__m128i second = _mm_xor_si128(_mm_and_si128(c, high), sign);
+
+				if (Layout::U < Layout::V) {
+					u = first;
+					v = second;
+				}
+				else {
+					u = second;
+					v = first;
+				}
+			}
+
+			/*
+			 * Loads 8 zero-centred U and V samples of a planar or semi-planar row,
+			 * in the high byte of 16-bit words like Unpack422_SSE2.
+			 */
+			template <ChromaLayout Chroma>
+			inline void LoadChroma_SSE2(const std::uint8_t * u, const std::uint8_t * v, __m128i & cu, __m128i & cv)
+			{
+				const __m128i high = _mm_set1_epi16(-0x100);
+				const __m128i sign = _mm_set1_epi16(-0x8000);
+				const __m128i zero = _mm_setzero_si128();
+
+				if (Chroma == ChromaLayout::Planar) {
+					cu = _mm_xor_si128(_mm_unpacklo_epi8(zero, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u))), sign);
+					cv = _mm_xor_si128(_mm_unpacklo_epi8(zero, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v))), sign);
+				}
+				else {
+					const std::uint8_t * base = (Chroma == ChromaLayout::UV) ? u : v;
+
+					__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base));
+					__m128i first = _mm_xor_si128(_mm_slli_epi16(c, 8), sign);
+					__m128i second = _mm_xor_si128(_mm_and_si128(c, high), sign);
+
+					cu = (Chroma == ChromaLayout::UV) ? first : second;
+					cv = (Chroma == ChromaLayout::UV) ? second : first;
+				}
+			}
+
+			/* YuvCoefficients broadcast to vectors, created once per row. */
+			struct YuvVectors_SSE2
+			{
+				__m128i yScale;
+				__m128i yBias;
+				__m128i vr;
+				__m128i ug;
+				__m128i vg;
+				__m128i ub;
+			};
+
+			inline YuvVectors_SSE2 LoadCoefficients_SSE2(const YuvCoefficients & coeffs)
+			{
+				return {
+					_mm_set1_epi16(coeffs.yScale),
+					_mm_set1_epi16(coeffs.yBias),
+					_mm_set1_epi16(coeffs.vr),
+					_mm_set1_epi16(coeffs.ug),
+					_mm_set1_epi16(coeffs.vg),
+					_mm_set1_epi16(coeffs.ub)
+				};
+			}
+
+			/*
+			 * Same arithmetic as ChromaTerms_C, see PixelFormatKernels.h. With the
+			 * samples in the high byte the high half of the product is the
+			 * truncated 8-bit fixed point result.
+			 */
+			inline void ChromaTerms_SSE2(__m128i u, __m128i v, const YuvVectors_SSE2 & k, __m128i & u1, __m128i & rg, __m128i & v1)
+			{
+				u1 = _mm_mulhi_epi16(u, k.ub);
+				rg = _mm_add_epi16(_mm_mulhi_epi16(u, k.ug), _mm_mulhi_epi16(v, k.vg));
+				v1 = _mm_mulhi_epi16(v, k.vr);
+			}
+
+			/* Scales 8 luma samples given in the high byte of 16-bit words. */
+			inline __m128i LumaTerm_SSE2(__m128i y, const YuvVectors_SSE2 & k)
+			{
+				return _mm_add_epi16(_mm_mulhi_epu16(y, k.yScale), k.yBias);
+			}
+
+			/*
+			 * Applies the chroma terms of 8 macro-pixels to 16 luma samples. The
+			 * unsigned saturation of the pack is the clip() of the scalar code.
+			 */
+			inline void YuvToRgb_SSE2(__m128i y, const YuvVectors_SSE2 & k, __m128i u1, __m128i rg, __m128i v1,
+				__m128i & r, __m128i & g, __m128i & b)
+			{
+				const __m128i zero = _mm_setzero_si128();
+
+				__m128i yLo = LumaTerm_SSE2(_mm_unpacklo_epi8(zero, y), k);
+				__m128i yHi = LumaTerm_SSE2(_mm_unpackhi_epi8(zero, y), k);
+
+				r = _mm_packus_epi16(_mm_add_epi16(yLo, _mm_unpacklo_epi16(v1, v1)),
+					_mm_add_epi16(yHi, _mm_unpackhi_epi16(v1, v1)));
+				g = _mm_packus_epi16(_mm_sub_epi16(yLo, _mm_unpacklo_epi16(rg, rg)),
+					_mm_sub_epi16(yHi, _mm_unpackhi_epi16(rg, rg)));
+				b = _mm_packus_epi16(_mm_add_epi16(yLo, _mm_unpacklo_epi16(u1, u1)),
+					_mm_add_epi16(yHi, _mm_unpackhi_epi16(u1, u1)));
+			}
+
+			/* Interleaves 16 pixels of three components and opaque alpha into 64 bytes. */
+			inline void StoreRGB32_SSE2(std::uint8_t * dest, __m128i c0, __m128i c1, __m128i c2)
+			{
+				const __m128i alpha = _mm_set1_epi8(-1);
+
+				__m128i lo01 = _mm_unpacklo_epi8(c0, c1);
+				__m128i hi01 = _mm_unpackhi_epi8(c0, c1);
+				__m128i lo2a = _mm_unpacklo_epi8(c2, alpha);
+				__m128i hi2a = _mm_unpackhi_epi8(c2, alpha);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_unpacklo_epi16(lo01, lo2a));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 16), _mm_unpackhi_epi16(lo01, lo2a));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 32), _mm_unpacklo_epi16(hi01, hi2a));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 48), _mm_unpackhi_epi16(hi01, hi2a));
+			}
+		}
+	}
+}
+
+#endif
@@ -59,6 +59,9 @@ namespace avdev
 			void setState(StreamState state);
 			StreamState getState() const;
 
+			/* Holds off state transitions of other threads, e.g. while reconfiguring. */
+			std::unique_lock<std::recursive_mutex> lockState();
+
 			void initBuffer(size_t length);
 			void freeBuffer();
 			void writeBuffer(const std::uint8_t * data, size_t length);
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_THREAD_POOL_H_
+#define AVDEV_CORE_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace avdev
+{
+	/*
+	 * Process-wide worker pool for data-parallel work, e.g. converting the row
+	 * bands of a video frame. The pool grows on demand and is shared by all
+	 * streams.
+	 */
+	class ThreadPool
+	{
+		public:
+			static ThreadPool & instance();
+
+			/* Makes sure the pool has at least the given number of workers. */
+			void reserve(unsigned threads);
+
+			unsigned getThreadCount();
+
+			/*
+			 * Runs task(0) to task(count - 1) and returns when all of them have
+			 * finished. The calling thread takes part in the work. The first
+			 * exception thrown by a task is rethrown to the caller. The task is
+			 * called by reference, queuing it does not allocate.
+			 */
+			template <typename Task>
+			void parallelFor(unsigned count, const Task & task)
+			{
+				parallelFor(count, [](const void * context, unsigned index) {
+					(*static_cast<const Task *>(context))(index);
+				}, &task);
+			}
+
+			void parallelFor(unsigned count, void (*task)(const void *, unsigned), const void * context);
+
+			// Delete copy and move constructors and assign operators.
+			ThreadPool(const ThreadPool &) = delete;
+			ThreadPool(ThreadPool &&) = delete;
+			ThreadPool & operator=(const ThreadPool &) = delete;
+			ThreadPool & operator=(ThreadPool &&) = delete;
+
+		private:
+			/* A parallelFor call, owned by the calling thread. Guarded by the pool mutex. */
+			struct Job
+			{
+				void (*task)(const void *, unsigned);
+				const void * context;
+				unsigned count;
+				unsigned next;
+				unsigned pending;
+				std::exception_ptr error;
+				std::condition_variable done;
+			};
+
+			ThreadPool();
+			~ThreadPool();
+
+			/* Claims and runs the next index of the job, to be called locked. */
+			void runTask(std::unique_lock<std::mutex> & lock, Job * job);
+
+			void run();
+
+		private:
+			std::mutex mutex;
+			std::condition_variable cond;
+
+			/* Jobs with unclaimed indices, in call order. */
+			std::vector<Job *> jobs;
+			std::vector<std::thread> workers;
+			bool running;
+	};
+}
+
+#endif
@@ -18,6 +18,7 @@
 #define AVDEV_CORE_VIDEO_CAPTURE_DEVICE_H_
 
 #include <memory>
+#include <vector>
 #include "VideoDevice.h"
 #include "VideoSink.h"
 #include "VideoOutputStream.h"
@@ -36,6 +37,12 @@ namespace avdev
 			virtual std::list<PictureControl> getPictureControls() = 0;
 			virtual std::list<CameraControl> getCameraControls() = 0;
 
+			/*
+			 * Frame rates the device captures the format at, in ascending order.
+			 * Empty, if the device does not report them.
+			 */
+			virtual std::vector<float> getFrameRates(const PictureFormat & format);
+
 			virtual void setPictureControlAutoMode(PictureControlType type, bool autoMode) = 0;
 			virtual bool getPictureControlAutoMode(PictureControlType type) = 0;
 			virtual void setPictureControlValue(PictureControlType type, long value) = 0;
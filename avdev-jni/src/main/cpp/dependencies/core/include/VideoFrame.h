@@ -0,0 +1,117 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_VIDEO_FRAME_H_
+#define AVDEV_CORE_VIDEO_FRAME_H_
+
+#include "avdev.h"
+#include "FrameView.h"
+#include "PictureFormat.h"
+#include "VideoFrameInfo.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace avdev
+{
+	class VideoFramePool;
+
+	/*
+	 * A video frame stored in one buffer of a VideoFramePool, with rows without
+	 * padding. Frames are reference counted with PVideoFrame, the last reference
+	 * returns the frame to its pool.
+	 */
+	class VideoFrame
+	{
+		public:
+			VideoFrame(const VideoFrame &) = delete;
+			VideoFrame & operator=(const VideoFrame &) = delete;
+
+			/*
+			 * Sets format and length of the content. The buffer never grows, so
+			 * that frames don't allocate while streaming. Throws, if the length
+			 * exceeds the capacity the pool was created with.
+			 */
+			void setFormat(const PictureFormat & format, size_t length);
+			const PictureFormat & getFormat() const;
+
+			void setInfo(const VideoFrameInfo & info);
+			const VideoFrameInfo & getInfo() const;
+
+			std::uint8_t * getData();
+			const std::uint8_t * getData() const;
+
+			size_t getLength() const;
+			size_t getCapacity() const;
+
+			/* The planes of an uncompressed frame. */
+			FrameView getView();
+			ConstFrameView getView() const;
+
+			void retain();
+			void release();
+
+		private:
+			friend class VideoFramePool;
+
+			explicit VideoFrame(size_t capacity);
+
+		private:
+			ByteBuffer data;
+			size_t length;
+			PictureFormat format;
+			VideoFrameInfo info;
+			std::atomic<unsigned> refCount;
+
+			/* Set while the frame is in use, keeps the pool alive. */
+			std::shared_ptr<VideoFramePool> pool;
+	};
+
+	/*
+	 * Reference to a pooled VideoFrame. Copies share the frame without
+	 * allocating and may be passed to other threads.
+	 */
+	class PVideoFrame
+	{
+		public:
+			PVideoFrame();
+
+			/* Adopts a reference already counted for the frame. */
+			explicit PVideoFrame(VideoFrame * frame);
+
+			PVideoFrame(const PVideoFrame & other);
+			PVideoFrame(PVideoFrame && other);
+			~PVideoFrame();
+
+			PVideoFrame & operator=(const PVideoFrame & other);
+			PVideoFrame & operator=(PVideoFrame && other);
+
+			VideoFrame * get() const;
+			VideoFrame * operator->() const;
+			VideoFrame & operator*() const;
+
+			explicit operator bool() const;
+
+			void reset();
+
+		private:
+			VideoFrame * frame;
+	};
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_VIDEO_FRAME_INFO_H_
+#define AVDEV_CORE_VIDEO_FRAME_INFO_H_
+
+#include <cstdint>
+
+namespace avdev
+{
+	/* Capture metadata of a video frame, passed by value to the sinks. */
+	struct VideoFrameInfo
+	{
+		/* Capture time in nanoseconds on the monotonic clock, 0 if unknown. */
+		std::int64_t timestamp = 0;
+
+		/* Counted by the device, gaps indicate frames that were not delivered. */
+		std::uint32_t sequence = 0;
+
+		/* Number of frames lost since the previously delivered frame. */
+		std::uint32_t dropped = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_CORE_VIDEO_FRAME_POOL_H_
+#define AVDEV_CORE_VIDEO_FRAME_POOL_H_
+
+#include "VideoFrame.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace avdev
+{
+	/*
+	 * A fixed number of frames allocated up front, e.g. for the negotiated
+	 * format of a stream. Frames in use keep the pool alive, so that they can
+	 * outlive the stream that acquired them.
+	 */
+	class VideoFramePool : public std::enable_shared_from_this<VideoFramePool>
+	{
+		public:
+			static std::shared_ptr<VideoFramePool> create(unsigned count, size_t frameSize);
+
+			VideoFramePool(const VideoFramePool &) = delete;
+			VideoFramePool & operator=(const VideoFramePool &) = delete;
+
+			/* Returns a free frame, or an empty reference if all frames are in use. */
+			PVideoFrame acquire();
+
+			unsigned getFrameCount() const;
+			size_t getFrameSize() const;
+
+		private:
+			friend class VideoFrame;
+
+			VideoFramePool(unsigned count, size_t frameSize);
+
+			/* Called with the last reference of a frame released. */
+			void recycle(VideoFrame * frame);
+
+		private:
+			std::mutex mutex;
+			std::vector<std::unique_ptr<VideoFrame>> frames;
+			std::vector<VideoFrame *> freeFrames;
+			size_t frameSize;
+	};
+}
+
+#endif
@@ -17,7 +17,15 @@
 #ifndef AVDEV_CORE_VIDEO_OUTPUT_STREAM_H_
 #define AVDEV_CORE_VIDEO_OUTPUT_STREAM_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include "FrameDeliveryQueue.h"
+#include "Orientation.h"
+#include "PixelFormatConverter.h"
+#include "VideoFrameInfo.h"
+#include "VideoFramePool.h"
 #include "VideoStream.h"
 #include "VideoSink.h"
 
@@ -32,10 +40,241 @@ namespace avdev
 			VideoOutputStream(PVideoSink sink);
 			virtual ~VideoOutputStream() {};
 
+			/*
+			 * Number of threads used to convert the pixel format of a frame, if
+			 * conversion is required. Takes effect when the stream is opened.
+			 */
+			void setConversionThreads(unsigned threads);
+			unsigned getConversionThreads() const;
+
+			/*
+			 * Number of threads decoding compressed frames, if decoding is
+			 * required. With more than one thread the frames are copied from
+			 * the capture buffers and decoded in parallel, but still written
+			 * to the sink in capture order. Takes effect when the stream is
+			 * started.
+			 */
+			void setDecodeThreads(unsigned threads);
+			unsigned getDecodeThreads() const;
+
+			/*
+			 * Writes compressed frames, e.g. Motion-JPEG, to the sink as captured,
+			 * tagged with the compressed pixel format, instead of decoding and
+			 * converting them. Motion-JPEG frames of many cameras omit the
+			 * Huffman tables. Takes effect when the stream is opened.
+			 */
+			void setCompressedPassthrough(bool passthrough);
+			bool getCompressedPassthrough() const;
+
+			/*
+			 * Number of buffers the device captures into. More buffers absorb
+			 * a jittering sink, at the cost of memory and, if the sink falls
+			 * behind, latency. Takes effect when the stream is opened.
+			 */
+			void setBufferCount(unsigned count);
+			unsigned getBufferCount() const;
+
+			/*
+			 * Writes only the newest of the captured frames that are ready, the
+			 * older ones are dropped. Keeps the latency at one frame, when the
+			 * sink is slower than the device.
+			 */
+			void setLatestFrameOnly(bool latestOnly);
+			bool getLatestFrameOnly() const;
+
+			/*
+			 * Captures on the threads of a process-wide reactor shared by all
+			 * streams with this option, instead of a thread per stream. Takes
+			 * effect when the stream is started.
+			 */
+			void setSharedCapture(bool shared);
+			bool getSharedCapture() const;
+
+			/*
+			 * Number of frames waiting for the sink on a separate delivery
+			 * thread, so that a slow sink does not hold up capturing. With 0
+			 * the sink is called on the capture thread. When the queue is
+			 * full, frames are dropped according to the drop policy. Frames
+			 * for attached sinks of other formats share the queue. Takes
+			 * effect when the stream is opened.
+			 */
+			void setDeliveryQueueSize(unsigned frames);
+			unsigned getDeliveryQueueSize() const;
+
+			void setFrameDropPolicy(FrameDropPolicy policy);
+			FrameDropPolicy getFrameDropPolicy() const;
+
+			/*
+			 * Mirrors and rotates the frames during pixel format conversion.
+			 * Takes effect when the stream is opened.
+			 */
+			void setOrientation(Orientation orientation);
+			Orientation getOrientation() const;
+
+			/*
+			 * Attaches a further sink receiving the frames converted to the given
+			 * format, with the orientation of the stream applied. Sinks requesting
+			 * the same format share the conversion and the frames, which are not
+			 * copied per sink. Sinks can be attached and detached while the stream
+			 * is started. Compressed frames passed through are only written to
+			 * sinks requesting the format of the stream.
+			 */
+			void attachSink(PVideoSink sink, const PictureFormat & format);
+			void detachSink(PVideoSink sink);
+
+			/*
+			 * Changes the picture format and frame rate of an opened or started
+			 * stream, which keeps its state. Streams reuse their device, buffers
+			 * and conversion where possible, instead of being closed and opened
+			 * again. A closed stream applies both when opened. If the new
+			 * configuration fails, the stream is closed.
+			 */
+			void reconfigure(PictureFormat format, float frameRate);
+
+			/*
+			 * Time in milliseconds from the last reconfiguration to the delivery
+			 * of its first frame, 0 until the first frame arrived.
+			 */
+			float getReconfigureLatency() const;
+
 		protected:
 			void writeVideoFrame(const std::uint8_t * data, size_t length);
+			void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format);
+
+			/*
+			 * Queues the frame for delivery, if a delivery queue is set, or writes
+			 * it to the sink. The number of frames dropped since the previous
+			 * frame is filled in from the sequence gap on delivery. Queued frames
+			 * are copied to a pooled frame.
+			 */
+			void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+				const VideoFrameInfo & info);
+
+			/* Queues or writes a pooled frame without copying. */
+			void writeVideoFrame(PVideoFrame frame);
+
+			/*
+			 * Allocates the frame pool for frames of up to frameSize bytes. Next to
+			 * the frames being written and delivered and those in the delivery
+			 * queue, sinks may retain as many frames as the device has buffers.
+			 */
+			void initFramePool(size_t frameSize);
+
+			/* Returns an empty reference, if all frames are in use. The loss of the frame is counted. */
+			PVideoFrame acquireVideoFrame();
+
+			/* Returns the info with the dropped frames counted, to be called once per delivered frame. */
+			VideoFrameInfo countDroppedFrames(const VideoFrameInfo & info);
+
+			/* Restarts the drop detection, e.g. when the device restarts its sequence. */
+			void resetFrameSequence();
+
+			/* Format of the frames written to the sink passed on construction. */
+			void setOutputFormat(const PictureFormat & format);
+
+			/*
+			 * Set, if the own sink receives the frames of the output format without
+			 * copying, e.g. as dmabuf. Pooled frames of the output format are then
+			 * only written to the sinks attached with that format.
+			 */
+			void setOwnSinkShared(bool shared);
+
+			/* Returns true, if attached sinks share the frames of the given format. */
+			bool hasAttachedSinks(const PictureFormat & format);
+
+			/*
+			 * Converts a captured or decoded frame for the attached sinks which
+			 * don't share the frames written to the own sink.
+			 */
+			void writeAttachedSinks(const ConstFrameView & src, const PictureFormat & srcFormat,
+				const ColorSpace & colorSpace, const VideoFrameInfo & info);
+
+			/*
+			 * Applies the picture format and frame rate set by reconfigure(). By
+			 * default the stream is stopped, closed, opened and started again,
+			 * without passing through these states. Leaves the stream closed, if
+			 * it throws.
+			 */
+			virtual void reconfigureInternal(bool started);
+
+			/* Creates the delivery queue, if a queue size is set. */
+			void startDelivery();
+
+			/* Delivers the waiting frames, to be called when capturing has stopped. */
+			void stopDelivery();
 
 			PVideoSink sink;
+
+			/* Set while started with a delivery queue size. */
+			std::unique_ptr<FrameDeliveryQueue> deliveryQueue;
+
+			/* Set while opened, frames still in use keep it alive. */
+			std::shared_ptr<VideoFramePool> framePool;
+
+		private:
+			/* Sequence number expected for the next frame. */
+			struct FrameSequence
+			{
+				std::uint32_t next = 0;
+				bool valid = false;
+			};
+
+			/* Conversion state of the sinks attached with the same format. */
+			struct SinkOutputState
+			{
+				std::shared_ptr<PixelFormatConverter> converter;
+				PictureFormat srcFormat = PictureFormat(0, 0, PixelFormat::UNKNOWN);
+				std::shared_ptr<VideoFramePool> framePool;
+				FrameSequence sequence;
+				bool failed = false;
+			};
+
+			/* Replaced as a whole on attach and detach, the state is kept. */
+			struct SinkOutput
+			{
+				PictureFormat format;
+				std::vector<PVideoSink> sinks;
+				std::shared_ptr<SinkOutputState> state;
+			};
+
+			using SinkOutputs = std::vector<SinkOutput>;
+
+			static VideoFrameInfo CountDroppedFrames(FrameSequence & sequence, const VideoFrameInfo & info);
+
+			/* The requested format with width and height swapped by the orientation. */
+			PictureFormat getOrientedFormat(const PictureFormat & format) const;
+
+			std::shared_ptr<const SinkOutputs> getSinkOutputs();
+
+			void deliverVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+				const VideoFrameInfo & info);
+			void deliverVideoFrame(const PVideoFrame & frame);
+
+		private:
+			unsigned conversionThreads;
+			unsigned decodeThreads;
+			bool compressedPassthrough;
+			unsigned bufferCount;
+			bool latestFrameOnly;
+			bool sharedCapture;
+			unsigned deliveryQueueSize;
+			FrameDropPolicy dropPolicy;
+
+			FrameSequence sequence;
+
+			PictureFormat outputFormat;
+			bool ownSinkShared;
+
+			std::mutex sinkMutex;
+			std::shared_ptr<const SinkOutputs> sinkOutputs;
+
+			/* Frames lost since the frame pool was exhausted. */
+			std::atomic<std::uint64_t> poolExhaustedFrames;
+			Orientation orientation;
+
+			/* Monotonic time in ns of a reconfiguration waiting for its first frame, otherwise 0. */
+			std::atomic<std::int64_t> reconfigureTime;
+			std::atomic<std::int64_t> reconfigureLatency;
 	};
 
 
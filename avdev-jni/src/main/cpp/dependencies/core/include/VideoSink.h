@@ -17,8 +17,21 @@
 #ifndef AVDEV_CORE_VIDEO_SINK_H_
 #define AVDEV_CORE_VIDEO_SINK_H_
 
+#include "PictureFormat.h"
+#include "VideoFrame.h"
+#include "VideoFrameInfo.h"
+
+#include <cstddef>
+#include <cstdint>
+
 namespace avdev
 {
+	/*
+	 * Receives the frames of a video stream. The data passed to the raw
+	 * overloads is only valid during the call. Platform sinks receiving
+	 * frames as file descriptors, e.g. the V4L2 DmaBufVideoSink, must dup()
+	 * a descriptor to keep it past the release of the frame.
+	 */
 	class VideoSink
 	{
 		public:
@@ -27,6 +40,26 @@ namespace avdev
 
 			virtual void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format) = 0;
 
+			/*
+			 * Receives a frame with its capture metadata. Sinks which don't need
+			 * the metadata only implement the overload above.
+			 */
+			virtual void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+				const VideoFrameInfo & info)
+			{
+				writeVideoFrame(data, length, format);
+			}
+
+			/*
+			 * Receives a pooled frame. Sinks may keep a copy of the reference to
+			 * process the frame later or on another thread, which keeps the frame
+			 * from being reused by the stream.
+			 */
+			virtual void writeVideoFrame(const PVideoFrame & frame)
+			{
+				writeVideoFrame(frame->getData(), frame->getLength(), frame->getFormat(), frame->getInfo());
+			}
+
 			/* Prevent copy and assignment. */
 			VideoSink(const VideoSink & ref) = delete;
 			VideoSink & operator=(const VideoSink & ref) = delete;
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ColorSpace.h"
+
+namespace avdev
+{
+	ColorSpace::ColorSpace(YuvMatrix matrix, YuvRange range) :
+		matrix(matrix),
+		range(range)
+	{
+	}
+
+	bool ColorSpace::operator== (const ColorSpace & other) const
+	{
+		return (matrix == other.matrix && range == other.range);
+	}
+
+	bool ColorSpace::operator!= (const ColorSpace & other) const
+	{
+		return !(*this == other);
+	}
+
+	YuvMatrix ColorSpace::getMatrix() const
+	{
+		return matrix;
+	}
+
+	YuvRange ColorSpace::getRange() const
+	{
+		return range;
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuInfo.h"
+
+#include <atomic>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace avdev
+{
+	namespace CpuInfo
+	{
+		static std::atomic<unsigned> featureMask(~0U);
+
+		static unsigned detectFeatures()
+		{
+			unsigned features = 0;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_cpu_init();
+
+			if (__builtin_cpu_supports("sse2")) {
+				features |= static_cast<unsigned>(CpuFeature::SSE2);
+			}
+			if (__builtin_cpu_supports("ssse3")) {
+				features |= static_cast<unsigned>(CpuFeature::SSSE3);
+			}
+			if (__builtin_cpu_supports("avx2")) {
+				features |= static_cast<unsigned>(CpuFeature::AVX2);
+			}
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			int info[4];
+
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+
+			if (info[3] & (1 << 26)) {
+				features |= static_cast<unsigned>(CpuFeature::SSE2);
+			}
+			if (info[2] & (1 << 9)) {
+				features |= static_cast<unsigned>(CpuFeature::SSSE3);
+			}
+
+			// AVX2 requires the OS to save the YMM registers on context switches.
+			if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+				__cpuidex(info, 7, 0);
+
+				if (info[1] & (1 << 5)) {
+					features |= static_cast<unsigned>(CpuFeature::AVX2);
+				}
+			}
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+			features |= static_cast<unsigned>(CpuFeature::NEON);
+#endif
+
+			return features;
+		}
+
+		unsigned getFeatures()
+		{
+			static const unsigned features = detectFeatures();
+
+			return features & featureMask.load(std::memory_order_relaxed);
+		}
+
+		bool hasFeature(CpuFeature feature)
+		{
+			return (getFeatures() & static_cast<unsigned>(feature)) != 0;
+		}
+
+		void setFeatureMask(unsigned mask)
+		{
+			featureMask.store(mask, std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AVdevException.h"
+#include "FrameDeliveryQueue.h"
+#include "Log.h"
+
+#include <utility>
+
+namespace avdev
+{
+	FrameDeliveryQueue::FrameDeliveryQueue(unsigned capacity, FrameDropPolicy policy, FrameHandler handler) :
+		handler(handler),
+		policy(policy),
+		nextSequence(0),
+		droppedFrames(0),
+		sleeping(false),
+		running(true)
+	{
+		unsigned count = (capacity > 0) ? capacity : 1;
+
+		for (unsigned i = 0; i < count; ++i) {
+			slots.emplace_back(new Slot());
+		}
+
+		worker = std::thread(&FrameDeliveryQueue::run, this);
+	}
+
+	FrameDeliveryQueue::~FrameDeliveryQueue()
+	{
+		running.store(false);
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+		}
+
+		cond.notify_one();
+
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+
+	bool FrameDeliveryQueue::push(PVideoFrame frame)
+	{
+		Slot * slot = nullptr;
+
+		for (auto & s : slots) {
+			int expected = FREE;
+
+			if (s->state.compare_exchange_strong(expected, WRITING)) {
+				slot = s.get();
+				break;
+			}
+		}
+
+		if (slot == nullptr && policy == FrameDropPolicy::DropOldest) {
+			// Replace the oldest frame the consumer has not yet claimed.
+			slot = claimOldest(WRITING);
+		}
+
+		if (slot == nullptr) {
+			droppedFrames++;
+			return false;
+		}
+
+		bool replaced = static_cast<bool>(slot->frame);
+
+		if (replaced) {
+			droppedFrames++;
+		}
+
+		// A replaced frame returns to its pool.
+		slot->frame = std::move(frame);
+		slot->sequence.store(nextSequence.fetch_add(1));
+		slot->state.store(READY);
+
+		// Sequentially consistent with the consumer announcing to sleep, either
+		// the consumer sees the ready slot or it is woken up.
+		if (sleeping.load()) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+			}
+
+			cond.notify_one();
+		}
+
+		return !replaced;
+	}
+
+	std::uint64_t FrameDeliveryQueue::getDroppedFrames() const
+	{
+		return droppedFrames.load();
+	}
+
+	FrameDeliveryQueue::Slot * FrameDeliveryQueue::findOldest(std::uint64_t * sequence)
+	{
+		Slot * oldest = nullptr;
+		std::uint64_t oldestSequence = 0;
+
+		for (auto & s : slots) {
+			if (s->state.load() == READY) {
+				std::uint64_t sequence = s->sequence.load();
+
+				if (oldest == nullptr || sequence < oldestSequence) {
+					oldest = s.get();
+					oldestSequence = sequence;
+				}
+			}
+		}
+
+		*sequence = oldestSequence;
+
+		return oldest;
+	}
+
+	FrameDeliveryQueue::Slot * FrameDeliveryQueue::claimOldest(int state)
+	{
+		while (true) {
+			std::uint64_t sequence;
+			Slot * slot = findOldest(&sequence);
+
+			if (slot == nullptr) {
+				return nullptr;
+			}
+
+			int expected = READY;
+
+			if (!slot->state.compare_exchange_strong(expected, state)) {
+				// Claimed by the other side in the meantime.
+				continue;
+			}
+
+			// The scan is no snapshot. The slot may have been replaced by a newer
+			// frame, or an older frame may have become ready after it was scanned.
+			std::uint64_t older;
+
+			if (slot->sequence.load() != sequence || (findOldest(&older) != nullptr && older < sequence)) {
+				slot->state.store(READY);
+				continue;
+			}
+
+			return slot;
+		}
+	}
+
+	void FrameDeliveryQueue::run()
+	{
+		while (true) {
+			Slot * slot = claimOldest(READING);
+
+			if (slot == nullptr) {
+				// Waiting frames are delivered before stopping.
+				if (!running.load()) {
+					return;
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+
+				sleeping.store(true);
+
+				std::uint64_t sequence;
+
+				cond.wait(lock, [this, &sequence]() { return !running.load() || findOldest(&sequence) != nullptr; });
+
+				sleeping.store(false);
+				continue;
+			}
+
+			// The slot is free again while the frame is delivered.
+			PVideoFrame frame = std::move(slot->frame);
+
+			slot->state.store(FREE);
+
+			try {
+				handler(frame);
+			}
+			catch (AVdevException & e) {
+				LOGDEV_WARN("FrameDeliveryQueue: Failed to deliver frame: %s", e.what());
+			}
+			catch (std::exception & e) {
+				LOGDEV_ERROR("FrameDeliveryQueue: Unhandled exception in frame handler: %s", e.what());
+			}
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameView.h"
+
+namespace avdev
+{
+	static bool IsSemiPlanar(PixelFormat format)
+	{
+		return format == PixelFormat::NV12 || format == PixelFormat::NV21;
+	}
+
+	/* Planar formats with the V plane in front of the U plane. */
+	static bool IsPlanarYVU(PixelFormat format)
+	{
+		return format == PixelFormat::YV12 || format == PixelFormat::YVU420;
+	}
+
+	static std::size_t GetPlaneStride(const PictureFormat & format, int plane, std::size_t stride)
+	{
+		if (stride == 0) {
+			return GetPlaneRowSize(format, plane);
+		}
+		if (plane == 0) {
+			return stride;
+		}
+		if (IsSemiPlanar(format.getPixelFormat())) {
+			return (stride + 1) & ~static_cast<std::size_t>(1);
+		}
+
+		return (stride + 1) / 2;
+	}
+
+	template <typename T>
+	static BasicFrameView<T> CreateFrameView(const PictureFormat & format, T * buffer, std::size_t stride)
+	{
+		const int planes = GetPlaneCount(format.getPixelFormat());
+
+		BasicFrameView<T> view;
+
+		for (int i = 0; i < planes; i++) {
+			// Planes are stored in view order, except for the swapped chroma planes.
+			int plane = (planes == 3 && IsPlanarYVU(format.getPixelFormat()) && i > 0) ? 3 - i : i;
+			std::size_t planeStride = GetPlaneStride(format, plane, stride);
+
+			view.data[plane] = buffer;
+			view.stride[plane] = static_cast<std::ptrdiff_t>(planeStride);
+
+			buffer += planeStride * GetPlaneHeight(format, plane);
+		}
+
+		return view;
+	}
+
+	int GetPlaneCount(PixelFormat format)
+	{
+		switch (format) {
+			case PixelFormat::NV12:
+			case PixelFormat::NV21:
+				return 2;
+			case PixelFormat::I420:
+			case PixelFormat::YV12:
+			case PixelFormat::YVU420:
+			case PixelFormat::YUV422P:
+				return 3;
+			default:
+				return 1;
+		}
+	}
+
+	std::size_t GetPlaneRowSize(const PictureFormat & format, int plane)
+	{
+		const std::size_t width = format.getWidth();
+		const std::size_t chromaWidth = (width + 1) / 2;
+
+		switch (format.getPixelFormat()) {
+			case PixelFormat::NV12:
+			case PixelFormat::NV21:
+				return (plane == 0) ? width : chromaWidth * 2;
+			case PixelFormat::I420:
+			case PixelFormat::YV12:
+			case PixelFormat::YVU420:
+			case PixelFormat::YUV422P:
+				return (plane == 0) ? width : chromaWidth;
+			case PixelFormat::YUYV:
+			case PixelFormat::YVYU:
+			case PixelFormat::UYVY:
+				return width * 2;
+			default:
+				return width * format.getBytesPerPixel();
+		}
+	}
+
+	unsigned GetPlaneHeight(const PictureFormat & format, int plane)
+	{
+		const unsigned height = format.getHeight();
+
+		if (plane == 0 || format.getPixelFormat() == PixelFormat::YUV422P) {
+			return height;
+		}
+
+		return (height + 1) / 2;
+	}
+
+	std::size_t GetFrameSize(const PictureFormat & format, std::size_t stride)
+	{
+		const int planes = GetPlaneCount(format.getPixelFormat());
+
+		std::size_t size = 0;
+
+		for (int i = 0; i < planes; i++) {
+			size += GetPlaneStride(format, i, stride) * GetPlaneHeight(format, i);
+		}
+
+		return size;
+	}
+
+	FrameView MakeFrameView(const PictureFormat & format, std::uint8_t * buffer, std::size_t stride)
+	{
+		return CreateFrameView(format, buffer, stride);
+	}
+
+	ConstFrameView MakeFrameView(const PictureFormat & format, const std::uint8_t * buffer, std::size_t stride)
+	{
+		return CreateFrameView(format, buffer, stride);
+	}
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Orientation.h"
+
+namespace avdev
+{
+	Orientation::Orientation(Rotation rotation, bool mirror) :
+		rotation(rotation),
+		mirror(mirror)
+	{
+	}
+
+	Orientation Orientation::flipVertical()
+	{
+		return Orientation(Rotation::Rotate180, true);
+	}
+
+	bool Orientation::operator== (const Orientation & other) const
+	{
+		return (rotation == other.rotation && mirror == other.mirror);
+	}
+
+	bool Orientation::operator!= (const Orientation & other) const
+	{
+		return !(*this == other);
+	}
+
+	Rotation Orientation::getRotation() const
+	{
+		return rotation;
+	}
+
+	bool Orientation::isMirrored() const
+	{
+		return mirror;
+	}
+
+	bool Orientation::isIdentity() const
+	{
+		return (rotation == Rotation::None && !mirror);
+	}
+
+	bool Orientation::swapsDimensions() const
+	{
+		return (rotation == Rotation::Rotate90 || rotation == Rotation::Rotate270);
+	}
+}
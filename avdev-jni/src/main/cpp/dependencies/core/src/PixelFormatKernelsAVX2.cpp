@@ -0,0 +1,309 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelFormatKernels.h"
+
+#include <immintrin.h>
+
+namespace avdev
+{
+	namespace kernels
+	{
+		namespace
+		{
+			/*
+			 * Splits 32 packed 4:2:2 pixels into 32 luma bytes and 16 zero-centred
+			 * U and V samples in the high byte of 16-bit words. The 128-bit lane
+			 * interleaving of the packs is undone by the 64-bit permutes.
+			 */
+			template <typename Layout>
+			inline void Unpack422_AVX2(const std::uint8_t * src, __m256i & y, __m256i & u, __m256i & v)
+			{
+				const __m256i mask = _mm256_set1_epi16(0x00FF);
+				const __m256i high = _mm256_set1_epi16(-0x100);
+				const __m256i sign = _mm256_set1_epi16(-0x8000);
+
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+				__m256i c;
+
+				if (Layout::Y0 == 0) {
+					y = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+					c = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+				}
+				else {
+					y = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+					c = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+				}
+
+				y = _mm256_permute4x64_epi64(y, 0xD8);
+				c = _mm256_permute4x64_epi64(c, 0xD8);
+
+				__m256i first = _mm256_xor_si256(_mm256_slli_epi16(c, 8), sign);
+				__m256i second = _mm256_xor_si256(_mm256_and_si256(c, high), sign);
+
+				if (Layout::U < Layout::V) {
+					u = first;
+					v = second;
+				}
+				else {
+					u = second;
+					v = first;
+				}
+			}
+
+			/*
+			 * Loads 16 zero-centred U and V samples of a planar or semi-planar row,
+			 * in the high byte of 16-bit words like Unpack422_AVX2.
+			 */
+			template <ChromaLayout Chroma>
+			inline void LoadChroma_AVX2(const std::uint8_t * u, const std::uint8_t * v, __m256i & cu, __m256i & cv)
+			{
+				const __m256i high = _mm256_set1_epi16(-0x100);
+				const __m256i sign = _mm256_set1_epi16(-0x8000);
+
+				if (Chroma == ChromaLayout::Planar) {
+					__m256i u16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(u)));
+					__m256i v16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v)));
+
+					cu = _mm256_xor_si256(_mm256_slli_epi16(u16, 8), sign);
+					cv = _mm256_xor_si256(_mm256_slli_epi16(v16, 8), sign);
+				}
+				else {
+					const std::uint8_t * base = (Chroma == ChromaLayout::UV) ? u : v;
+
+					__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base));
+					__m256i first = _mm256_xor_si256(_mm256_slli_epi16(c, 8), sign);
+					__m256i second = _mm256_xor_si256(_mm256_and_si256(c, high), sign);
+
+					cu = (Chroma == ChromaLayout::UV) ? first : second;
+					cv = (Chroma == ChromaLayout::UV) ? second : first;
+				}
+			}
+
+			/* YuvCoefficients broadcast to vectors, created once per row. */
+			struct YuvVectors_AVX2
+			{
+				__m256i yScale;
+				__m256i yBias;
+				__m256i vr;
+				__m256i ug;
+				__m256i vg;
+				__m256i ub;
+			};
+
+			inline YuvVectors_AVX2 LoadCoefficients_AVX2(const YuvCoefficients & coeffs)
+			{
+				return {
+					_mm256_set1_epi16(coeffs.yScale),
+					_mm256_set1_epi16(coeffs.yBias),
+					_mm256_set1_epi16(coeffs.vr),
+					_mm256_set1_epi16(coeffs.ug),
+					_mm256_set1_epi16(coeffs.vg),
+					_mm256_set1_epi16(coeffs.ub)
+				};
+			}
+
+			inline void ChromaTerms_AVX2(__m256i u, __m256i v, const YuvVectors_AVX2 & k, __m256i & u1, __m256i & rg, __m256i & v1)
+			{
+				u1 = _mm256_mulhi_epi16(u, k.ub);
+				rg = _mm256_add_epi16(_mm256_mulhi_epi16(u, k.ug), _mm256_mulhi_epi16(v, k.vg));
+				v1 = _mm256_mulhi_epi16(v, k.vr);
+			}
+
+			inline __m256i LumaTerm_AVX2(__m256i y, const YuvVectors_AVX2 & k)
+			{
+				return _mm256_add_epi16(_mm256_mulhi_epu16(y, k.yScale), k.yBias);
+			}
+
+			inline void YuvToRgb_AVX2(__m256i y, const YuvVectors_AVX2 & k, __m256i u1, __m256i rg, __m256i v1,
+				__m256i & r, __m256i & g, __m256i & b)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+
+				__m256i yLo = LumaTerm_AVX2(_mm256_unpacklo_epi8(zero, y), k);
+				__m256i yHi = LumaTerm_AVX2(_mm256_unpackhi_epi8(zero, y), k);
+
+				r = _mm256_packus_epi16(_mm256_add_epi16(yLo, _mm256_unpacklo_epi16(v1, v1)),
+					_mm256_add_epi16(yHi, _mm256_unpackhi_epi16(v1, v1)));
+				g = _mm256_packus_epi16(_mm256_sub_epi16(yLo, _mm256_unpacklo_epi16(rg, rg)),
+					_mm256_sub_epi16(yHi, _mm256_unpackhi_epi16(rg, rg)));
+				b = _mm256_packus_epi16(_mm256_add_epi16(yLo, _mm256_unpacklo_epi16(u1, u1)),
+					_mm256_add_epi16(yHi, _mm256_unpackhi_epi16(u1, u1)));
+			}
+
+			/* Interleaves 32 R, G and B samples into 96 bytes of RGB24. */
+			inline void StoreRGB24_AVX2(std::uint8_t * dest, __m256i r, __m256i g, __m256i b)
+			{
+				const __m256i r0 = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5));
+				const __m256i g0 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1));
+				const __m256i b0 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1));
+				const __m256i r1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1));
+				const __m256i g1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10));
+				const __m256i b1 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1));
+				const __m256i r2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1));
+				const __m256i g2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1));
+				const __m256i b2 = _mm256_broadcastsi128_si256(_mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15));
+
+				// Each lane holds 16 pixels, producing three 16 byte blocks per lane.
+				__m256i out0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r0), _mm256_shuffle_epi8(g, g0)), _mm256_shuffle_epi8(b, b0));
+				__m256i out1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r1), _mm256_shuffle_epi8(g, g1)), _mm256_shuffle_epi8(b, b1));
+				__m256i out2 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r, r2), _mm256_shuffle_epi8(g, g2)), _mm256_shuffle_epi8(b, b2));
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), _mm256_permute2x128_si256(out0, out1, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + 32), _mm256_permute2x128_si256(out2, out0, 0x30));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + 64), _mm256_permute2x128_si256(out1, out2, 0x31));
+			}
+
+			/* Interleaves 32 pixels of three components and opaque alpha into 128 bytes. */
+			inline void StoreRGB32_AVX2(std::uint8_t * dest, __m256i c0, __m256i c1, __m256i c2)
+			{
+				const __m256i alpha = _mm256_set1_epi8(-1);
+
+				__m256i lo01 = _mm256_unpacklo_epi8(c0, c1);
+				__m256i hi01 = _mm256_unpackhi_epi8(c0, c1);
+				__m256i lo2a = _mm256_unpacklo_epi8(c2, alpha);
+				__m256i hi2a = _mm256_unpackhi_epi8(c2, alpha);
+
+				// Lane 0 holds pixels 0-15, lane 1 pixels 16-31.
+				__m256i p0 = _mm256_unpacklo_epi16(lo01, lo2a);
+				__m256i p1 = _mm256_unpackhi_epi16(lo01, lo2a);
+				__m256i p2 = _mm256_unpacklo_epi16(hi01, hi2a);
+				__m256i p3 = _mm256_unpackhi_epi16(hi01, hi2a);
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), _mm256_permute2x128_si256(p0, p1, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + 32), _mm256_permute2x128_si256(p2, p3, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + 64), _mm256_permute2x128_si256(p0, p1, 0x31));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+			}
+
+			template <typename Order>
+			inline void StoreRGB_AVX2(std::uint8_t * dest, __m256i r, __m256i g, __m256i b)
+			{
+				if (Order::Size == 4) {
+					StoreRGB32_AVX2(dest, r, g, b);
+				}
+				else if (Order::R == 0) {
+					StoreRGB24_AVX2(dest, r, g, b);
+				}
+				else {
+					StoreRGB24_AVX2(dest, b, g, r);
+				}
+			}
+		}
+
+		template <typename Layout>
+		void Packed422ToRGB24_AVX2(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_AVX2 k = LoadCoefficients_AVX2(coeffs);
+			int count = pixels & ~31;
+
+			for (int j = 0; j < count; j += 32) {
+				__m256i y, u, v, u1, rg, v1, r, g, b;
+
+				Unpack422_AVX2<Layout>(src, y, u, v);
+				ChromaTerms_AVX2(u, v, k, u1, rg, v1);
+				YuvToRgb_AVX2(y, k, u1, rg, v1, r, g, b);
+				StoreRGB24_AVX2(dest, r, g, b);
+
+				src += 64;
+				dest += 96;
+			}
+
+			Packed422ToRGB24_C<Layout>(src, dest, pixels - count, coeffs);
+		}
+
+		template void Packed422ToRGB24_AVX2<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_AVX2<YVYULayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_AVX2<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_AVX2(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_AVX2 k = LoadCoefficients_AVX2(coeffs);
+			const int step = (Chroma == ChromaLayout::Planar) ? 1 : 2;
+			int count = width & ~31;
+
+			for (int j = 0; j < count; j += 32) {
+				__m256i luma, cu, cv, u1, rg, v1, r, g, b;
+
+				luma = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + j));
+				LoadChroma_AVX2<Chroma>(u + j / 2 * step, v + j / 2 * step, cu, cv);
+				ChromaTerms_AVX2(cu, cv, k, u1, rg, v1);
+				YuvToRgb_AVX2(luma, k, u1, rg, v1, r, g, b);
+				StoreRGB_AVX2<Order>(dest, r, g, b);
+
+				dest += 32 * Order::Size;
+			}
+
+			PlanarToRGB_C<Chroma, Order>(y + count, u + count / 2 * step, v + count / 2 * step, dest, width - count, coeffs);
+		}
+
+		template void PlanarToRGB_AVX2<ChromaLayout::Planar, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::Planar, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::Planar, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::UV, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::UV, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::UV, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::VU, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::VU, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_AVX2<ChromaLayout::VU, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+
+		template <typename Layout>
+		void Packed422ToGrey_AVX2(const std::uint8_t * src, std::uint8_t * dest, int pixels)
+		{
+			const __m256i mask = _mm256_set1_epi16(0x00FF);
+			int count = pixels & ~31;
+
+			for (int j = 0; j < count; j += 32) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+
+				if (Layout::Y0 == 0) {
+					a = _mm256_and_si256(a, mask);
+					b = _mm256_and_si256(b, mask);
+				}
+				else {
+					a = _mm256_srli_epi16(a, 8);
+					b = _mm256_srli_epi16(b, 8);
+				}
+
+				__m256i y = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), y);
+
+				src += 64;
+				dest += 32;
+			}
+
+			Packed422ToGrey_C<Layout>(src, dest, pixels - count);
+		}
+
+		template void Packed422ToGrey_AVX2<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_AVX2<YVYULayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_AVX2<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int);
+	}
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelFormatKernels.h"
+
+#include <arm_neon.h>
+
+namespace avdev
+{
+	namespace kernels
+	{
+		namespace
+		{
+			/* YuvCoefficients broadcast to vectors, created once per row. */
+			struct YuvVectors_NEON
+			{
+				int16x8_t yScale;
+				int16x8_t yBias;
+				int16x8_t vr;
+				int16x8_t ug;
+				int16x8_t vg;
+				int16x8_t ub;
+			};
+
+			inline YuvVectors_NEON LoadCoefficients_NEON(const YuvCoefficients & coeffs)
+			{
+				return {
+					vdupq_n_s16(coeffs.yScale),
+					vdupq_n_s16(coeffs.yBias),
+					vdupq_n_s16(coeffs.vr),
+					vdupq_n_s16(coeffs.ug),
+					vdupq_n_s16(coeffs.vg),
+					vdupq_n_s16(coeffs.ub)
+				};
+			}
+
+			/*
+			 * Same arithmetic as the scalar kernels for 8 macro-pixels, see
+			 * PixelFormatKernels.h. The doubling high-half multiply of samples
+			 * shifted left by 7 is the truncated 8-bit fixed point product.
+			 */
+			inline void YuvToRgb_NEON(uint8x8_t y0, uint8x8_t y1, uint8x8_t u8, uint8x8_t v8,
+				const YuvVectors_NEON & k, uint8x8_t * r, uint8x8_t * g, uint8x8_t * b)
+			{
+				const uint8x8_t bias = vdup_n_u8(128);
+
+				int16x8_t u = vshlq_n_s16(vreinterpretq_s16_u16(vsubl_u8(u8, bias)), 7);
+				int16x8_t v = vshlq_n_s16(vreinterpretq_s16_u16(vsubl_u8(v8, bias)), 7);
+
+				int16x8_t u1 = vqdmulhq_s16(u, k.ub);
+				int16x8_t rg = vaddq_s16(vqdmulhq_s16(u, k.ug), vqdmulhq_s16(v, k.vg));
+				int16x8_t v1 = vqdmulhq_s16(v, k.vr);
+
+				int16x8_t ye = vaddq_s16(vqdmulhq_s16(vreinterpretq_s16_u16(vshll_n_u8(y0, 7)), k.yScale), k.yBias);
+				int16x8_t yo = vaddq_s16(vqdmulhq_s16(vreinterpretq_s16_u16(vshll_n_u8(y1, 7)), k.yScale), k.yBias);
+
+				// Even pixels in [0], odd pixels in [1].
+				r[0] = vqmovun_s16(vaddq_s16(ye, v1));
+				r[1] = vqmovun_s16(vaddq_s16(yo, v1));
+				g[0] = vqmovun_s16(vsubq_s16(ye, rg));
+				g[1] = vqmovun_s16(vsubq_s16(yo, rg));
+				b[0] = vqmovun_s16(vaddq_s16(ye, u1));
+				b[1] = vqmovun_s16(vaddq_s16(yo, u1));
+			}
+
+			/* Stores 16 pixels given as separate R, G and B vectors. */
+			template <typename Order>
+			inline void StoreRGB_NEON(std::uint8_t * dest, uint8x16_t r, uint8x16_t g, uint8x16_t b)
+			{
+				if (Order::Size == 4) {
+					uint8x16x4_t out;
+
+					out.val[Order::R] = r;
+					out.val[Order::G] = g;
+					out.val[Order::B] = b;
+					out.val[3] = vdupq_n_u8(0xFF);
+					vst4q_u8(dest, out);
+				}
+				else {
+					uint8x16x3_t out;
+
+					out.val[Order::R] = r;
+					out.val[Order::G] = g;
+					out.val[Order::B] = b;
+					vst3q_u8(dest, out);
+				}
+			}
+		}
+
+		template <typename Layout>
+		void Packed422ToRGB24_NEON(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_NEON k = LoadCoefficients_NEON(coeffs);
+			int count = pixels & ~31;
+
+			for (int j = 0; j < count; j += 32) {
+				// De-interleaves the 16 macro-pixels by sample position.
+				uint8x16x4_t in = vld4q_u8(src);
+
+				uint8x16_t y0 = in.val[Layout::Y0];
+				uint8x16_t y1 = in.val[Layout::Y1];
+				uint8x16_t u = in.val[Layout::U];
+				uint8x16_t v = in.val[Layout::V];
+
+				uint8x8_t rLo[2], gLo[2], bLo[2];
+				uint8x8_t rHi[2], gHi[2], bHi[2];
+
+				YuvToRgb_NEON(vget_low_u8(y0), vget_low_u8(y1), vget_low_u8(u), vget_low_u8(v), k, rLo, gLo, bLo);
+				YuvToRgb_NEON(vget_high_u8(y0), vget_high_u8(y1), vget_high_u8(u), vget_high_u8(v), k, rHi, gHi, bHi);
+
+				uint8x16x2_t r = vzipq_u8(vcombine_u8(rLo[0], rHi[0]), vcombine_u8(rLo[1], rHi[1]));
+				uint8x16x2_t g = vzipq_u8(vcombine_u8(gLo[0], gHi[0]), vcombine_u8(gLo[1], gHi[1]));
+				uint8x16x2_t b = vzipq_u8(vcombine_u8(bLo[0], bHi[0]), vcombine_u8(bLo[1], bHi[1]));
+
+				uint8x16x3_t out;
+
+				out.val[0] = r.val[0];
+				out.val[1] = g.val[0];
+				out.val[2] = b.val[0];
+				vst3q_u8(dest, out);
+
+				out.val[0] = r.val[1];
+				out.val[1] = g.val[1];
+				out.val[2] = b.val[1];
+				vst3q_u8(dest + 48, out);
+
+				src += 64;
+				dest += 96;
+			}
+
+			Packed422ToRGB24_C<Layout>(src, dest, pixels - count, coeffs);
+		}
+
+		template void Packed422ToRGB24_NEON<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_NEON<YVYULayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_NEON<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_NEON(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_NEON k = LoadCoefficients_NEON(coeffs);
+			const int step = (Chroma == ChromaLayout::Planar) ? 1 : 2;
+			int count = width & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				// Even luma samples in val[0], odd ones in val[1].
+				uint8x8x2_t luma = vld2_u8(y + j);
+				uint8x8_t cu, cv;
+
+				if (Chroma == ChromaLayout::Planar) {
+					cu = vld1_u8(u + j / 2);
+					cv = vld1_u8(v + j / 2);
+				}
+				else {
+					const std::uint8_t * base = (Chroma == ChromaLayout::UV) ? u : v;
+					uint8x8x2_t c = vld2_u8(base + j);
+
+					cu = (Chroma == ChromaLayout::UV) ? c.val[0] : c.val[1];
+					cv = (Chroma == ChromaLayout::UV) ? c.val[1] : c.val[0];
+				}
+
+				uint8x8_t r[2], g[2], b[2];
+
+				YuvToRgb_NEON(luma.val[0], luma.val[1], cu, cv, k, r, g, b);
+
+				uint8x8x2_t rz = vzip_u8(r[0], r[1]);
+				uint8x8x2_t gz = vzip_u8(g[0], g[1]);
+				uint8x8x2_t bz = vzip_u8(b[0], b[1]);
+
+				StoreRGB_NEON<Order>(dest, vcombine_u8(rz.val[0], rz.val[1]),
+					vcombine_u8(gz.val[0], gz.val[1]), vcombine_u8(bz.val[0], bz.val[1]));
+
+				dest += 16 * Order::Size;
+			}
+
+			PlanarToRGB_C<Chroma, Order>(y + count, u + count / 2 * step, v + count / 2 * step, dest, width - count, coeffs);
+		}
+
+		template void PlanarToRGB_NEON<ChromaLayout::Planar, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::Planar, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::Planar, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::UV, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::UV, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::UV, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::VU, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::VU, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_NEON<ChromaLayout::VU, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+
+		template <typename Layout>
+		void Packed422ToGrey_NEON(const std::uint8_t * src, std::uint8_t * dest, int pixels)
+		{
+			int count = pixels & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				// Even bytes in val[0], odd bytes in val[1].
+				uint8x16x2_t px = vld2q_u8(src);
+
+				vst1q_u8(dest, (Layout::Y0 == 0) ? px.val[0] : px.val[1]);
+
+				src += 32;
+				dest += 16;
+			}
+
+			Packed422ToGrey_C<Layout>(src, dest, pixels - count);
+		}
+
+		template void Packed422ToGrey_NEON<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_NEON<YVYULayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_NEON<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int);
+	}
+}
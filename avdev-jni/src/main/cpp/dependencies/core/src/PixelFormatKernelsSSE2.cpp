@@ -0,0 +1,151 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelFormatKernelsX86.h"
+
+namespace avdev
+{
+	namespace kernels
+	{
+		namespace
+		{
+			template <typename Order>
+			inline void StoreRGB_SSE2(std::uint8_t * dest, __m128i r, __m128i g, __m128i b)
+			{
+				if (Order::Size == 4) {
+					StoreRGB32_SSE2(dest, r, g, b);
+					return;
+				}
+
+				alignas(16) std::uint8_t rBuf[16];
+				alignas(16) std::uint8_t gBuf[16];
+				alignas(16) std::uint8_t bBuf[16];
+
+				// SSE2 has no byte shuffle, interleave the 24-bit pixels in scalar code.
+				_mm_store_si128(reinterpret_cast<__m128i *>(rBuf), r);
+				_mm_store_si128(reinterpret_cast<__m128i *>(gBuf), g);
+				_mm_store_si128(reinterpret_cast<__m128i *>(bBuf), b);
+
+				for (int i = 0; i < 16; i++) {
+					dest[Order::R] = rBuf[i];
+					dest[Order::G] = gBuf[i];
+					dest[Order::B] = bBuf[i];
+
+					dest += Order::Size;
+				}
+			}
+		}
+
+		template <typename Layout>
+		void Packed422ToRGB24_SSE2(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_SSE2 k = LoadCoefficients_SSE2(coeffs);
+			int count = pixels & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				__m128i y, u, v, u1, rg, v1, r, g, b;
+
+				Unpack422_SSE2<Layout>(src, y, u, v);
+				ChromaTerms_SSE2(u, v, k, u1, rg, v1);
+				YuvToRgb_SSE2(y, k, u1, rg, v1, r, g, b);
+				StoreRGB_SSE2<RGB24Order>(dest, r, g, b);
+
+				src += 32;
+				dest += 48;
+			}
+
+			Packed422ToRGB24_C<Layout>(src, dest, pixels - count, coeffs);
+		}
+
+		template void Packed422ToRGB24_SSE2<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_SSE2<YVYULayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_SSE2<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_SSE2(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_SSE2 k = LoadCoefficients_SSE2(coeffs);
+			const int step = (Chroma == ChromaLayout::Planar) ? 1 : 2;
+			int count = width & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				__m128i luma, cu, cv, u1, rg, v1, r, g, b;
+
+				luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + j));
+				LoadChroma_SSE2<Chroma>(u + j / 2 * step, v + j / 2 * step, cu, cv);
+				ChromaTerms_SSE2(cu, cv, k, u1, rg, v1);
+				YuvToRgb_SSE2(luma, k, u1, rg, v1, r, g, b);
+				StoreRGB_SSE2<Order>(dest, r, g, b);
+
+				dest += 16 * Order::Size;
+			}
+
+			PlanarToRGB_C<Chroma, Order>(y + count, u + count / 2 * step, v + count / 2 * step, dest, width - count, coeffs);
+		}
+
+		template void PlanarToRGB_SSE2<ChromaLayout::Planar, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::Planar, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::Planar, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::UV, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::UV, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::UV, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::VU, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::VU, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSE2<ChromaLayout::VU, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+
+		template <typename Layout>
+		void Packed422ToGrey_SSE2(const std::uint8_t * src, std::uint8_t * dest, int pixels)
+		{
+			const __m128i mask = _mm_set1_epi16(0x00FF);
+			int count = pixels & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+
+				if (Layout::Y0 == 0) {
+					a = _mm_and_si128(a, mask);
+					b = _mm_and_si128(b, mask);
+				}
+				else {
+					a = _mm_srli_epi16(a, 8);
+					b = _mm_srli_epi16(b, 8);
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_packus_epi16(a, b));
+
+				src += 32;
+				dest += 16;
+			}
+
+			Packed422ToGrey_C<Layout>(src, dest, pixels - count);
+		}
+
+		template void Packed422ToGrey_SSE2<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_SSE2<YVYULayout>(const std::uint8_t *, std::uint8_t *, int);
+		template void Packed422ToGrey_SSE2<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int);
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelFormatKernelsX86.h"
+
+#include <tmmintrin.h>
+
+namespace avdev
+{
+	namespace kernels
+	{
+		namespace
+		{
+			/* Interleaves 16 R, G and B samples into 48 bytes of RGB24. */
+			inline void StoreRGB24_SSSE3(std::uint8_t * dest, __m128i r, __m128i g, __m128i b)
+			{
+				const __m128i r0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+				const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+				const __m128i b0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+				const __m128i r1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+				const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+				const __m128i b1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+				const __m128i r2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+				const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+				const __m128i b2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+				__m128i out0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0));
+				__m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1));
+				__m128i out2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), out0);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 16), out1);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 32), out2);
+			}
+
+			template <typename Order>
+			inline void StoreRGB_SSSE3(std::uint8_t * dest, __m128i r, __m128i g, __m128i b)
+			{
+				if (Order::Size == 4) {
+					StoreRGB32_SSE2(dest, r, g, b);
+				}
+				else if (Order::R == 0) {
+					StoreRGB24_SSSE3(dest, r, g, b);
+				}
+				else {
+					StoreRGB24_SSSE3(dest, b, g, r);
+				}
+			}
+		}
+
+		template <typename Layout>
+		void Packed422ToRGB24_SSSE3(const std::uint8_t * src, std::uint8_t * dest, int pixels, const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_SSE2 k = LoadCoefficients_SSE2(coeffs);
+			int count = pixels & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				__m128i y, u, v, u1, rg, v1, r, g, b;
+
+				Unpack422_SSE2<Layout>(src, y, u, v);
+				ChromaTerms_SSE2(u, v, k, u1, rg, v1);
+				YuvToRgb_SSE2(y, k, u1, rg, v1, r, g, b);
+				StoreRGB24_SSSE3(dest, r, g, b);
+
+				src += 32;
+				dest += 48;
+			}
+
+			Packed422ToRGB24_C<Layout>(src, dest, pixels - count, coeffs);
+		}
+
+		template void Packed422ToRGB24_SSSE3<YUYVLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_SSSE3<YVYULayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+		template void Packed422ToRGB24_SSSE3<UYVYLayout>(const std::uint8_t *, std::uint8_t *, int, const YuvCoefficients &);
+
+		template <ChromaLayout Chroma, typename Order>
+		void PlanarToRGB_SSSE3(const std::uint8_t * y, const std::uint8_t * u, const std::uint8_t * v, std::uint8_t * dest, int width,
+			const YuvCoefficients & coeffs)
+		{
+			const YuvVectors_SSE2 k = LoadCoefficients_SSE2(coeffs);
+			const int step = (Chroma == ChromaLayout::Planar) ? 1 : 2;
+			int count = width & ~15;
+
+			for (int j = 0; j < count; j += 16) {
+				__m128i luma, cu, cv, u1, rg, v1, r, g, b;
+
+				luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + j));
+				LoadChroma_SSE2<Chroma>(u + j / 2 * step, v + j / 2 * step, cu, cv);
+				ChromaTerms_SSE2(cu, cv, k, u1, rg, v1);
+				YuvToRgb_SSE2(luma, k, u1, rg, v1, r, g, b);
+				StoreRGB_SSSE3<Order>(dest, r, g, b);
+
+				dest += 16 * Order::Size;
+			}
+
+			PlanarToRGB_C<Chroma, Order>(y + count, u + count / 2 * step, v + count / 2 * step, dest, width - count, coeffs);
+		}
+
+		template void PlanarToRGB_SSSE3<ChromaLayout::Planar, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::Planar, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::Planar, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::UV, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::UV, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::UV, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::VU, RGB24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::VU, BGR24Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+		template void PlanarToRGB_SSSE3<ChromaLayout::VU, RGB32Order>(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int,
+			const YuvCoefficients &);
+	}
+}
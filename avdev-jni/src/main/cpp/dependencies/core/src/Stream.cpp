@@ -154,6 +154,11 @@ namespace avdev
 		return state;
 	}
 
+	std::unique_lock<std::recursive_mutex> Stream::lockState()
+	{
+		return std::unique_lock<std::recursive_mutex>(mutex);
+	}
+
 	void Stream::initBuffer(size_t length)
 	{
 		if (buffer.size() != length) {
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace avdev
+{
+	/* Upper bound, to keep a misconfigured stream from spawning hundreds of threads. */
+	static const unsigned MAX_WORKERS = 64;
+
+	ThreadPool & ThreadPool::instance()
+	{
+		static ThreadPool instance;
+
+		return instance;
+	}
+
+	ThreadPool::ThreadPool() :
+		running(true)
+	{
+		// Keeps queuing free of allocations, with a job per converting stream.
+		jobs.reserve(MAX_WORKERS);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			running = false;
+		}
+
+		cond.notify_all();
+
+		for (std::thread & worker : workers) {
+			if (worker.joinable()) {
+				worker.join();
+			}
+		}
+	}
+
+	void ThreadPool::reserve(unsigned threads)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (threads > MAX_WORKERS) {
+			threads = MAX_WORKERS;
+		}
+
+		while (workers.size() < threads) {
+			workers.emplace_back(&ThreadPool::run, this);
+		}
+	}
+
+	unsigned ThreadPool::getThreadCount()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		return static_cast<unsigned>(workers.size());
+	}
+
+	void ThreadPool::parallelFor(unsigned count, void (*task)(const void *, unsigned), const void * context)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		Job job;
+		job.task = task;
+		job.context = context;
+		job.count = count;
+		job.next = 0;
+		job.pending = count;
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		jobs.push_back(&job);
+
+		for (unsigned i = 1; i < count; i++) {
+			cond.notify_one();
+		}
+
+		while (job.next < job.count) {
+			runTask(lock, &job);
+		}
+
+		// Help with queued work instead of idling, the pool may be busy with other streams.
+		while (job.pending > 0) {
+			if (!jobs.empty()) {
+				runTask(lock, jobs.front());
+			}
+			else {
+				job.done.wait(lock);
+			}
+		}
+
+		// No worker refers to the job anymore, its last task has completed under the lock.
+		if (job.error) {
+			std::rethrow_exception(job.error);
+		}
+	}
+
+	void ThreadPool::runTask(std::unique_lock<std::mutex> & lock, Job * job)
+	{
+		unsigned index = job->next++;
+
+		if (job->next == job->count) {
+			jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+		}
+
+		lock.unlock();
+
+		std::exception_ptr error;
+
+		try {
+			job->task(job->context, index);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		lock.lock();
+
+		if (error && !job->error) {
+			job->error = error;
+		}
+
+		// The caller may return as soon as the lock is released.
+		if (--job->pending == 0) {
+			job->done.notify_all();
+		}
+	}
+
+	void ThreadPool::run()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true) {
+			cond.wait(lock, [this]() { return !running || !jobs.empty(); });
+
+			if (!running && jobs.empty()) {
+				return;
+			}
+
+			runTask(lock, jobs.front());
+		}
+	}
+}
@@ -22,4 +22,9 @@ namespace avdev
 		VideoDevice(name, descriptor)
 	{
 	}
+
+	std::vector<float> VideoCaptureDevice::getFrameRates(const PictureFormat & format)
+	{
+		return std::vector<float>();
+	}
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AVdevException.h"
+#include "VideoFrame.h"
+#include "VideoFramePool.h"
+
+#include <utility>
+
+namespace avdev
+{
+	VideoFrame::VideoFrame(size_t capacity) :
+		data(capacity),
+		length(0),
+		format(0, 0, PixelFormat::UNKNOWN),
+		info(),
+		refCount(0)
+	{
+	}
+
+	void VideoFrame::setFormat(const PictureFormat & format, size_t length)
+	{
+		if (data.size() < length) {
+			throw AVdevException("Frame length %llu exceeds the frame capacity %llu",
+				static_cast<unsigned long long>(length), static_cast<unsigned long long>(data.size()));
+		}
+
+		this->format = format;
+		this->length = length;
+	}
+
+	const PictureFormat & VideoFrame::getFormat() const
+	{
+		return format;
+	}
+
+	void VideoFrame::setInfo(const VideoFrameInfo & info)
+	{
+		this->info = info;
+	}
+
+	const VideoFrameInfo & VideoFrame::getInfo() const
+	{
+		return info;
+	}
+
+	std::uint8_t * VideoFrame::getData()
+	{
+		return data.data();
+	}
+
+	const std::uint8_t * VideoFrame::getData() const
+	{
+		return data.data();
+	}
+
+	size_t VideoFrame::getLength() const
+	{
+		return length;
+	}
+
+	size_t VideoFrame::getCapacity() const
+	{
+		return data.size();
+	}
+
+	FrameView VideoFrame::getView()
+	{
+		return MakeFrameView(format, data.data());
+	}
+
+	ConstFrameView VideoFrame::getView() const
+	{
+		return MakeFrameView(format, data.data());
+	}
+
+	void VideoFrame::retain()
+	{
+		refCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void VideoFrame::release()
+	{
+		if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			// The pool may be destroyed with the last frame, which deletes this frame.
+			std::shared_ptr<VideoFramePool> owner = std::move(pool);
+
+			owner->recycle(this);
+		}
+	}
+
+
+	PVideoFrame::PVideoFrame() :
+		frame(nullptr)
+	{
+	}
+
+	PVideoFrame::PVideoFrame(VideoFrame * frame) :
+		frame(frame)
+	{
+	}
+
+	PVideoFrame::PVideoFrame(const PVideoFrame & other) :
+		frame(other.frame)
+	{
+		if (frame) {
+			frame->retain();
+		}
+	}
+
+	PVideoFrame::PVideoFrame(PVideoFrame && other) :
+		frame(other.frame)
+	{
+		other.frame = nullptr;
+	}
+
+	PVideoFrame::~PVideoFrame()
+	{
+		reset();
+	}
+
+	PVideoFrame & PVideoFrame::operator=(const PVideoFrame & other)
+	{
+		if (other.frame) {
+			other.frame->retain();
+		}
+
+		reset();
+
+		frame = other.frame;
+
+		return *this;
+	}
+
+	PVideoFrame & PVideoFrame::operator=(PVideoFrame && other)
+	{
+		if (this != &other) {
+			reset();
+
+			frame = other.frame;
+			other.frame = nullptr;
+		}
+
+		return *this;
+	}
+
+	VideoFrame * PVideoFrame::get() const
+	{
+		return frame;
+	}
+
+	VideoFrame * PVideoFrame::operator->() const
+	{
+		return frame;
+	}
+
+	VideoFrame & PVideoFrame::operator*() const
+	{
+		return *frame;
+	}
+
+	PVideoFrame::operator bool() const
+	{
+		return frame != nullptr;
+	}
+
+	void PVideoFrame::reset()
+	{
+		if (frame) {
+			frame->release();
+			frame = nullptr;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VideoFramePool.h"
+
+namespace avdev
+{
+	std::shared_ptr<VideoFramePool> VideoFramePool::create(unsigned count, size_t frameSize)
+	{
+		return std::shared_ptr<VideoFramePool>(new VideoFramePool(count, frameSize));
+	}
+
+	VideoFramePool::VideoFramePool(unsigned count, size_t frameSize) :
+		frameSize(frameSize)
+	{
+		frames.reserve(count);
+		freeFrames.reserve(count);
+
+		for (unsigned i = 0; i < count; ++i) {
+			frames.emplace_back(new VideoFrame(frameSize));
+			freeFrames.push_back(frames.back().get());
+		}
+	}
+
+	PVideoFrame VideoFramePool::acquire()
+	{
+		VideoFrame * frame;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			if (freeFrames.empty()) {
+				return PVideoFrame();
+			}
+
+			frame = freeFrames.back();
+			freeFrames.pop_back();
+		}
+
+		frame->length = 0;
+		frame->info = VideoFrameInfo();
+		frame->refCount.store(1, std::memory_order_relaxed);
+		frame->pool = shared_from_this();
+
+		return PVideoFrame(frame);
+	}
+
+	unsigned VideoFramePool::getFrameCount() const
+	{
+		return static_cast<unsigned>(frames.size());
+	}
+
+	size_t VideoFramePool::getFrameSize() const
+	{
+		return frameSize;
+	}
+
+	void VideoFramePool::recycle(VideoFrame * frame)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// Reserved for all frames, never allocates.
+		freeFrames.push_back(frame);
+	}
+}
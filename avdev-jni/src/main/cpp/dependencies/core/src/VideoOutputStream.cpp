@@ -14,22 +14,551 @@
  * limitations under the License.
  */
 
+#include "AVdevException.h"
 #include "VideoOutputStream.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
 
 namespace avdev
 {
+	static std::int64_t MonotonicTime()
+	{
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+	}
+
 	VideoOutputStream::VideoOutputStream(PVideoSink sink) :
 		VideoStream(),
-		sink(sink)
+		sink(sink),
+		conversionThreads(1),
+		decodeThreads(1),
+		compressedPassthrough(false),
+		bufferCount(4),
+		latestFrameOnly(false),
+		sharedCapture(false),
+		deliveryQueueSize(0),
+		dropPolicy(FrameDropPolicy::DropOldest),
+		sequence(),
+		outputFormat(0, 0, PixelFormat::UNKNOWN),
+		ownSinkShared(false),
+		poolExhaustedFrames(0),
+		orientation(),
+		reconfigureTime(0),
+		reconfigureLatency(0)
+	{
+	}
+
+	void VideoOutputStream::setConversionThreads(unsigned threads)
+	{
+		conversionThreads = (threads > 0) ? threads : 1;
+	}
+
+	unsigned VideoOutputStream::getConversionThreads() const
+	{
+		return conversionThreads;
+	}
+
+	void VideoOutputStream::setDecodeThreads(unsigned threads)
+	{
+		decodeThreads = (threads > 0) ? threads : 1;
+	}
+
+	unsigned VideoOutputStream::getDecodeThreads() const
+	{
+		return decodeThreads;
+	}
+
+	void VideoOutputStream::setCompressedPassthrough(bool passthrough)
+	{
+		compressedPassthrough = passthrough;
+	}
+
+	bool VideoOutputStream::getCompressedPassthrough() const
+	{
+		return compressedPassthrough;
+	}
+
+	void VideoOutputStream::setBufferCount(unsigned count)
+	{
+		bufferCount = (count > 0) ? count : 1;
+	}
+
+	unsigned VideoOutputStream::getBufferCount() const
+	{
+		return bufferCount;
+	}
+
+	void VideoOutputStream::setLatestFrameOnly(bool latestOnly)
+	{
+		latestFrameOnly = latestOnly;
+	}
+
+	bool VideoOutputStream::getLatestFrameOnly() const
+	{
+		return latestFrameOnly;
+	}
+
+	void VideoOutputStream::setSharedCapture(bool shared)
+	{
+		sharedCapture = shared;
+	}
+
+	bool VideoOutputStream::getSharedCapture() const
+	{
+		return sharedCapture;
+	}
+
+	void VideoOutputStream::setDeliveryQueueSize(unsigned frames)
+	{
+		deliveryQueueSize = frames;
+	}
+
+	unsigned VideoOutputStream::getDeliveryQueueSize() const
+	{
+		return deliveryQueueSize;
+	}
+
+	void VideoOutputStream::setFrameDropPolicy(FrameDropPolicy policy)
+	{
+		dropPolicy = policy;
+	}
+
+	FrameDropPolicy VideoOutputStream::getFrameDropPolicy() const
+	{
+		return dropPolicy;
+	}
+
+	void VideoOutputStream::setOrientation(Orientation orientation)
+	{
+		this->orientation = orientation;
+	}
+
+	Orientation VideoOutputStream::getOrientation() const
+	{
+		return orientation;
+	}
+
+	void VideoOutputStream::reconfigure(PictureFormat format, float frameRate)
 	{
+		std::unique_lock<std::recursive_mutex> lock = lockState();
+
+		StreamState state = getState();
+
+		if (state == StreamState::ENDED) {
+			throw AVdevException("Invalid stream state for reconfiguration: %s", getStateString(state).c_str());
+		}
+
+		setPictureFormat(format);
+		setFrameRate(frameRate);
+
+		if (state == StreamState::CLOSED) {
+			return;
+		}
+
+		reconfigureLatency = 0;
+		reconfigureTime = MonotonicTime();
+
+		try {
+			reconfigureInternal(state == StreamState::STARTED);
+		}
+		catch (...) {
+			reconfigureTime = 0;
+
+			// The device has been left closed.
+			setState(StreamState::CLOSED);
+			throw;
+		}
+	}
+
+	float VideoOutputStream::getReconfigureLatency() const
+	{
+		return reconfigureLatency / 1000000.F;
+	}
+
+	void VideoOutputStream::reconfigureInternal(bool started)
+	{
+		if (started) {
+			stopInternal();
+		}
+
+		closeInternal();
+		openInternal();
+
+		if (started) {
+			try {
+				startInternal();
+			}
+			catch (...) {
+				closeInternal();
+				throw;
+			}
+		}
 	}
 
 	void VideoOutputStream::writeVideoFrame(const std::uint8_t * data, size_t length)
+	{
+		writeVideoFrame(data, length, getPictureFormat());
+	}
+
+	void VideoOutputStream::writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format)
+	{
+		if (sink == nullptr) {
+			return;
+		}
+
+		sink->writeVideoFrame(data, length, format);
+	}
+
+	void VideoOutputStream::writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+		const VideoFrameInfo & info)
+	{
+		// Attached sinks sharing the frame need a pooled copy.
+		if (!deliveryQueue && !hasAttachedSinks(format)) {
+			deliverVideoFrame(data, length, format, info);
+			return;
+		}
+
+		PVideoFrame frame = acquireVideoFrame();
+
+		if (frame && frame->getCapacity() < length) {
+			// The pool is sized for the largest frame of the stream, see initFramePool().
+			LOGDEV_WARN("VideoOutputStream: Frame of %llu bytes exceeds the pooled frames of %llu bytes.",
+				static_cast<unsigned long long>(length), static_cast<unsigned long long>(frame->getCapacity()));
+
+			frame.reset();
+		}
+
+		if (!frame) {
+			if (!deliveryQueue) {
+				deliverVideoFrame(data, length, format, info);
+			}
+			return;
+		}
+
+		frame->setFormat(format, length);
+		frame->setInfo(info);
+
+		std::memcpy(frame->getData(), data, length);
+
+		writeVideoFrame(std::move(frame));
+	}
+
+	void VideoOutputStream::writeVideoFrame(PVideoFrame frame)
+	{
+		if (deliveryQueue) {
+			deliveryQueue->push(std::move(frame));
+		}
+		else {
+			deliverVideoFrame(frame);
+		}
+	}
+
+	void VideoOutputStream::initFramePool(size_t frameSize)
+	{
+		unsigned count = deliveryQueueSize + getBufferCount() + 2;
+
+		if (framePool && framePool->getFrameSize() >= frameSize && framePool->getFrameCount() == count) {
+			return;
+		}
+
+		framePool = VideoFramePool::create(count, frameSize);
+	}
+
+	PVideoFrame VideoOutputStream::acquireVideoFrame()
+	{
+		PVideoFrame frame;
+
+		if (framePool) {
+			frame = framePool->acquire();
+		}
+
+		if (!frame) {
+			poolExhaustedFrames++;
+		}
+
+		return frame;
+	}
+
+	void VideoOutputStream::deliverVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+		const VideoFrameInfo & info)
+	{
+		// Frames dropped by the delivery queue show up as sequence gaps.
+		VideoFrameInfo frameInfo = countDroppedFrames(info);
+
+		if (sink == nullptr) {
+			return;
+		}
+
+		sink->writeVideoFrame(data, length, format, frameInfo);
+	}
+
+	void VideoOutputStream::deliverVideoFrame(const PVideoFrame & frame)
+	{
+		const PictureFormat & format = frame->getFormat();
+		// The own sink received a shared frame, the copy is for the attached sinks.
+		const bool own = (format == outputFormat) && !ownSinkShared;
+		const SinkOutput * output = nullptr;
+
+		std::shared_ptr<const SinkOutputs> outputs = getSinkOutputs();
+
+		if (outputs) {
+			for (const SinkOutput & o : *outputs) {
+				if (getOrientedFormat(o.format) == format) {
+					output = &o;
+					break;
+				}
+			}
+		}
+
+		// Frames shared with the own sink are counted once.
+		if (own) {
+			frame->setInfo(countDroppedFrames(frame->getInfo()));
+		}
+		else if (output) {
+			frame->setInfo(CountDroppedFrames(output->state->sequence, frame->getInfo()));
+		}
+
+		if (own && sink != nullptr) {
+			sink->writeVideoFrame(frame);
+		}
+
+		if (output) {
+			for (const PVideoSink & attached : output->sinks) {
+				attached->writeVideoFrame(frame);
+			}
+		}
+	}
+
+	VideoFrameInfo VideoOutputStream::countDroppedFrames(const VideoFrameInfo & info)
+	{
+		// The first frame after a reconfiguration completes it.
+		if (reconfigureTime.load(std::memory_order_relaxed) != 0) {
+			std::int64_t time = reconfigureTime.exchange(0);
+
+			if (time != 0) {
+				reconfigureLatency = MonotonicTime() - time;
+
+				LOGDEV_INFO("VideoOutputStream: First frame %.1f ms after reconfiguration.",
+					getReconfigureLatency());
+			}
+		}
+
+		return CountDroppedFrames(sequence, info);
+	}
+
+	VideoFrameInfo VideoOutputStream::CountDroppedFrames(FrameSequence & sequence, const VideoFrameInfo & info)
+	{
+		VideoFrameInfo frameInfo = info;
+
+		// A sequence running backwards is a restart of the device, nothing was lost.
+		if (sequence.valid && static_cast<std::int32_t>(info.sequence - sequence.next) > 0) {
+			frameInfo.dropped += info.sequence - sequence.next;
+		}
+
+		sequence.next = info.sequence + 1;
+		sequence.valid = true;
+
+		return frameInfo;
+	}
+
+	void VideoOutputStream::resetFrameSequence()
+	{
+		sequence.valid = false;
+
+		std::shared_ptr<const SinkOutputs> outputs = getSinkOutputs();
+
+		if (outputs) {
+			for (const SinkOutput & output : *outputs) {
+				output.state->sequence.valid = false;
+			}
+		}
+	}
+
+	void VideoOutputStream::setOutputFormat(const PictureFormat & format)
+	{
+		outputFormat = format;
+	}
+
+	void VideoOutputStream::setOwnSinkShared(bool shared)
+	{
+		ownSinkShared = shared;
+	}
+
+	void VideoOutputStream::attachSink(PVideoSink sink, const PictureFormat & format)
 	{
 		if (sink == nullptr) {
 			return;
 		}
 
-		sink->writeVideoFrame(data, length, getPictureFormat());
+		std::unique_lock<std::mutex> lock(sinkMutex);
+
+		auto outputs = std::make_shared<SinkOutputs>(sinkOutputs ? *sinkOutputs : SinkOutputs());
+
+		auto output = std::find_if(outputs->begin(), outputs->end(), [&format](const SinkOutput & o) {
+			return o.format == format;
+		});
+
+		if (output == outputs->end()) {
+			outputs->push_back({ format, {}, std::make_shared<SinkOutputState>() });
+			output = outputs->end() - 1;
+		}
+
+		output->sinks.push_back(sink);
+
+		sinkOutputs = outputs;
+	}
+
+	void VideoOutputStream::detachSink(PVideoSink sink)
+	{
+		std::unique_lock<std::mutex> lock(sinkMutex);
+
+		if (!sinkOutputs) {
+			return;
+		}
+
+		auto outputs = std::make_shared<SinkOutputs>(*sinkOutputs);
+
+		for (SinkOutput & output : *outputs) {
+			output.sinks.erase(std::remove(output.sinks.begin(), output.sinks.end(), sink), output.sinks.end());
+		}
+
+		outputs->erase(std::remove_if(outputs->begin(), outputs->end(), [](const SinkOutput & o) {
+			return o.sinks.empty();
+		}), outputs->end());
+
+		sinkOutputs = outputs;
+	}
+
+	void VideoOutputStream::writeAttachedSinks(const ConstFrameView & src, const PictureFormat & srcFormat,
+		const ColorSpace & colorSpace, const VideoFrameInfo & info)
+	{
+		std::shared_ptr<const SinkOutputs> outputs = getSinkOutputs();
+
+		if (!outputs || IsCompressedFormat(srcFormat.getPixelFormat())) {
+			return;
+		}
+
+		for (const SinkOutput & output : *outputs) {
+			if (getOrientedFormat(output.format) == outputFormat) {
+				// Shares the frames written to the own sink.
+				continue;
+			}
+
+			SinkOutputState & state = *output.state;
+
+			if (state.srcFormat != srcFormat) {
+				state.srcFormat = srcFormat;
+				state.failed = false;
+				state.converter.reset();
+
+				try {
+					auto converter = std::make_shared<PixelFormatConverter>();
+					converter->init(srcFormat, output.format, colorSpace);
+					converter->setThreadCount(conversionThreads);
+					converter->setOrientation(orientation);
+
+					state.converter = converter;
+					state.framePool = VideoFramePool::create(deliveryQueueSize + getBufferCount() + 2,
+						GetFrameSize(converter->getOutputFormat()));
+				}
+				catch (AVdevException & e) {
+					LOGDEV_WARN("VideoOutputStream: Failed to convert frames for attached sink: %s", e.what());
+
+					state.failed = true;
+				}
+			}
+
+			if (state.failed) {
+				continue;
+			}
+
+			PVideoFrame frame = state.framePool->acquire();
+
+			if (!frame) {
+				poolExhaustedFrames++;
+				continue;
+			}
+
+			const PictureFormat & format = state.converter->getOutputFormat();
+
+			frame->setFormat(format, GetFrameSize(format));
+			frame->setInfo(info);
+
+			state.converter->convert(src, frame->getView());
+
+			writeVideoFrame(std::move(frame));
+		}
+	}
+
+	PictureFormat VideoOutputStream::getOrientedFormat(const PictureFormat & format) const
+	{
+		if (orientation.swapsDimensions()) {
+			return PictureFormat(format.getHeight(), format.getWidth(), format.getPixelFormat());
+		}
+
+		return format;
+	}
+
+	std::shared_ptr<const VideoOutputStream::SinkOutputs> VideoOutputStream::getSinkOutputs()
+	{
+		std::unique_lock<std::mutex> lock(sinkMutex);
+
+		return sinkOutputs;
+	}
+
+	bool VideoOutputStream::hasAttachedSinks(const PictureFormat & format)
+	{
+		std::shared_ptr<const SinkOutputs> outputs = getSinkOutputs();
+
+		if (!outputs) {
+			return false;
+		}
+
+		for (const SinkOutput & output : *outputs) {
+			if (getOrientedFormat(output.format) == format) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void VideoOutputStream::startDelivery()
+	{
+		if (deliveryQueueSize == 0) {
+			return;
+		}
+
+		deliveryQueue.reset(new FrameDeliveryQueue(deliveryQueueSize, dropPolicy, [this](const PVideoFrame & frame) {
+			deliverVideoFrame(frame);
+		}));
+	}
+
+	void VideoOutputStream::stopDelivery()
+	{
+		std::uint64_t exhausted = poolExhaustedFrames.exchange(0);
+
+		if (exhausted > 0) {
+			LOGDEV_WARN("VideoOutputStream: Frame pool exhausted, dropped %llu frames.",
+				static_cast<unsigned long long>(exhausted));
+		}
+
+		if (!deliveryQueue) {
+			return;
+		}
+
+		std::uint64_t dropped = deliveryQueue->getDroppedFrames();
+
+		if (dropped > 0) {
+			LOGDEV_WARN("VideoOutputStream: Sink too slow, dropped %llu frames.",
+				static_cast<unsigned long long>(dropped));
+		}
+
+		deliveryQueue.reset();
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_V4l2_ALIGNED_BUFFER_POOL_H_
+#define AVDEV_V4l2_ALIGNED_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace avdev
+{
+	/*
+	 * Page-aligned buffers for capturing with user pointers. Buffers are backed
+	 * by huge pages where possible and are kept for reuse until the pool is
+	 * cleared or destroyed.
+	 */
+	class AlignedBufferPool
+	{
+		public:
+			AlignedBufferPool();
+			~AlignedBufferPool();
+
+			AlignedBufferPool(const AlignedBufferPool &) = delete;
+			AlignedBufferPool & operator=(const AlignedBufferPool &) = delete;
+
+			/*
+			 * Makes the pool hold count buffers of at least size bytes. Buffers
+			 * that are large enough are kept.
+			 */
+			void reserve(size_t count, size_t size);
+			void clear();
+
+			std::uint8_t * getBuffer(size_t index) const;
+			size_t getBufferSize(size_t index) const;
+			size_t getBufferCount() const;
+
+		private:
+			struct Block
+			{
+				std::uint8_t * data;
+				size_t size;
+			};
+
+			static Block allocate(size_t size);
+			static void release(Block & block);
+
+			std::vector<Block> blocks;
+	};
+}
+
+#endif
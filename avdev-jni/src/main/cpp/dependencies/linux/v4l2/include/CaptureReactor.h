@@ -0,0 +1,95 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_V4l2_CAPTURE_REACTOR_H_
+#define AVDEV_V4l2_CAPTURE_REACTOR_H_
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace avdev
+{
+	/*
+	 * Process-wide epoll loop waiting for frames of all devices registered by
+	 * streams with shared capture. The handler of a ready device runs on one of
+	 * the reactor threads, never concurrently with itself. The reactor starts a
+	 * small, fixed number of threads with the first device, which all devices
+	 * share, instead of a thread per device.
+	 */
+	class CaptureReactor
+	{
+		public:
+			/* Returns false, if the device failed and is to be removed. */
+			using Handler = std::function<bool()>;
+
+			static CaptureReactor & instance();
+
+			/* Makes sure the reactor has at least the given number of threads. */
+			void reserve(unsigned threads);
+
+			unsigned getThreadCount();
+
+			/*
+			 * Number of threads started with the first device, 2 by default.
+			 * Threads already running are kept, a larger number starts further
+			 * threads right away.
+			 */
+			void setPoolSize(unsigned threads);
+			unsigned getPoolSize();
+
+			void add(int fd, Handler handler);
+
+			/*
+			 * Waits for a running handler of the device to return, unless called
+			 * by the handler itself.
+			 */
+			void remove(int fd);
+
+			// Delete copy and move constructors and assign operators.
+			CaptureReactor(const CaptureReactor &) = delete;
+			CaptureReactor(CaptureReactor &&) = delete;
+			CaptureReactor & operator=(const CaptureReactor &) = delete;
+			CaptureReactor & operator=(CaptureReactor &&) = delete;
+
+		private:
+			CaptureReactor();
+			~CaptureReactor();
+
+			void run();
+
+		private:
+			std::mutex mutex;
+			std::condition_variable cond;
+			std::map<int, Handler> handlers;
+
+			/* Devices whose handler is running, with the running thread. */
+			std::map<int, std::thread::id> busy;
+
+			std::vector<std::thread> workers;
+			unsigned poolSize;
+
+			int epollFd;
+
+			/* Wakes up all threads on destruction. */
+			int wakeFd;
+	};
+}
+
+#endif
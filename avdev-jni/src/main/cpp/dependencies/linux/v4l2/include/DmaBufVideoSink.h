@@ -0,0 +1,66 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_V4l2_DMA_BUF_VIDEO_SINK_H_
+#define AVDEV_V4l2_DMA_BUF_VIDEO_SINK_H_
+
+#include "PictureFormat.h"
+#include "VideoFrameInfo.h"
+#include "VideoSink.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace avdev
+{
+	/* A captured frame in a buffer shared as dmabuf file descriptor. */
+	struct DmaBufFrame
+	{
+		/* Owned by the stream, dup() it to keep it beyond the release of the frame. */
+		int fd;
+
+		/* Start and size of the frame within the buffer. */
+		size_t offset;
+		size_t length;
+
+		/* Row stride in bytes. */
+		size_t stride;
+
+		PictureFormat format;
+
+		VideoFrameInfo info;
+	};
+
+	/*
+	 * Sink receiving frames without copying, for in-process consumers such as
+	 * encoders. Frames that require decoding or conversion are still written
+	 * with writeVideoFrame().
+	 */
+	class DmaBufVideoSink : public VideoSink
+	{
+		public:
+			/*
+			 * The frame is not overwritten by the device until release has been
+			 * called, exactly once and from any thread. Holding on to frames
+			 * leaves the device fewer buffers to capture into. The descriptor of
+			 * the frame stays open until release, also if the stream is stopped
+			 * in the meantime. Sinks that use it afterwards must dup() it.
+			 */
+			virtual void writeDmaBufFrame(const DmaBufFrame & frame, std::function<void()> release) = 0;
+	};
+}
+
+#endif
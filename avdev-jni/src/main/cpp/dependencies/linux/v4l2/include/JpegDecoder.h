@@ -17,29 +17,93 @@
 #ifndef AVDEV_V4l2_JPEG_DECODER_H_
 #define AVDEV_V4l2_JPEG_DECODER_H_
 
+#include "PictureFormat.h"
 #include "Transform.h"
 
+#include <cstdio>
 #include <setjmp.h>
 #include <jpeglib.h>
+#include <vector>
 
 namespace avdev
 {
+	/*
+	 * Decodes JPEG and Motion-JPEG frames to RGB24 or I420. The decompressor is
+	 * created once and reused for every frame, as are the output buffer and row
+	 * table.
+	 */
 	class JpegDecoder : public Transform
 	{
 		public:
-			~JpegDecoder() {};
+			JpegDecoder(J_DCT_METHOD dctMethod = JDCT_IFAST);
+			~JpegDecoder();
+
+			JpegDecoder(const JpegDecoder &) = delete;
+			JpegDecoder & operator=(const JpegDecoder &) = delete;
 
 			void transform(Bytes input, size_t inputSize, Bytes * output, size_t * outputSize);
+
+			/* JDCT_IFAST is the fastest, JDCT_ISLOW and JDCT_FLOAT are more accurate. */
+			void setDctMethod(J_DCT_METHOD method);
+			J_DCT_METHOD getDctMethod() const;
+
+			/*
+			 * RGB24 or I420. I420 frames are read as raw YCbCr planes, without the
+			 * color conversion and chroma upsampling of the decompressor. 4:2:2
+			 * and 4:4:4 chroma is downsampled, grayscale frames get neutral chroma.
+			 */
+			void setOutputFormat(PixelFormat format);
+			PixelFormat getOutputFormat() const;
+
+			/*
+			 * Decodes at 1/scale of the frame size, with a scale of 1, 2, 4 or 8.
+			 * The scaled inverse DCT is considerably faster than decoding at
+			 * full size and downscaling afterwards.
+			 */
+			void setScale(unsigned scale);
+			unsigned getScale() const;
+
+			/* Returns the largest scale at which a frame is decoded to at least the minimum size. */
+			static unsigned selectScale(unsigned width, unsigned height, unsigned minWidth, unsigned minHeight);
+
+			/* Returns the width or height of a frame decoded at the given scale. */
+			static unsigned scaleSize(unsigned size, unsigned scale);
+
+			/*
+			 * Returns true, if the frame starts with an SOI and ends with an EOI
+			 * marker. Only the trailing zero padding some cameras append to the
+			 * frame is skipped, so that truncated frames are rejected cheaply.
+			 */
+			static bool isComplete(const std::uint8_t * data, size_t size);
 			
 		protected:
 			static void onError(j_common_ptr info);
 			static void onOutputMessage(j_common_ptr info);
 		
 		private:
+			struct ErrorManager : public jpeg_error_mgr
+			{
+				jmp_buf jmpBuffer;
+			};
+
+			void readScanlines();
+			void readRawData();
+
 			void addDHT(j_decompress_ptr decompress);
 			void writeHuffTable(j_decompress_ptr decompress, JHUFF_TBL ** table, const UINT8 * bits, const UINT8 * values);
-			
+
+			jpeg_decompress_struct decompress;
+			ErrorManager error;
+			J_DCT_METHOD dctMethod;
+			PixelFormat outputFormat;
+			unsigned scale;
+
 			ByteBuffer buffer;
+			std::vector<JSAMPROW> rows;
+
+			/* One iMCU row of each component, as written by jpeg_read_raw_data(). */
+			std::vector<std::uint8_t> rawBuffer;
+			std::vector<JSAMPROW> rawRows;
 	};
 }
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AVDEV_V4l2_PARALLEL_JPEG_DECODER_H_
+#define AVDEV_V4l2_PARALLEL_JPEG_DECODER_H_
+
+#include "JpegDecoder.h"
+#include "VideoFrameInfo.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace avdev
+{
+	/*
+	 * Decodes Motion-JPEG frames on several worker threads. Frames are copied
+	 * on push(), so that the capture buffer can be requeued immediately, and
+	 * decoded frames are handed to the frame handler in the order they were
+	 * pushed. At most twice as many frames as threads are in flight, further
+	 * frames are dropped.
+	 */
+	class ParallelJpegDecoder
+	{
+		public:
+			/*
+			 * Called with one decoded frame at a time, on one of the worker threads.
+			 * The frame info is the one passed to push().
+			 */
+			using FrameHandler = std::function<void(const std::uint8_t * data, size_t length, const VideoFrameInfo & info)>;
+
+			ParallelJpegDecoder(unsigned threads, PixelFormat outputFormat, unsigned scale, FrameHandler handler);
+
+			/* Delivers the frames in flight and stops the workers. */
+			~ParallelJpegDecoder();
+
+			ParallelJpegDecoder(const ParallelJpegDecoder &) = delete;
+			ParallelJpegDecoder & operator=(const ParallelJpegDecoder &) = delete;
+
+			/* Returns false, if the frame was dropped since all slots are in use. */
+			bool push(const std::uint8_t * data, size_t length, const VideoFrameInfo & info);
+
+			/* Number of frames dropped due to overflow. */
+			std::uint64_t getDroppedFrames();
+
+		private:
+			enum class SlotState {
+				FREE, FILLING, QUEUED, DECODING, DECODED, FAILED
+			};
+
+			/* A frame in flight. Each slot has its own decoder holding the decoded frame. */
+			struct Slot
+			{
+				JpegDecoder decoder;
+				ByteBuffer input;
+				size_t inputSize;
+				Bytes output;
+				size_t outputSize;
+				VideoFrameInfo info;
+				std::uint64_t sequence;
+				SlotState state;
+			};
+
+			void run();
+
+			/* Hands the decoded frames which are next in sequence to the handler. */
+			void deliver();
+
+		private:
+			std::vector<std::unique_ptr<Slot>> slots;
+			std::deque<Slot *> queue;
+			std::vector<std::thread> workers;
+
+			std::mutex mutex;
+			std::condition_variable cond;
+
+			/* Serializes the frame handler. */
+			std::mutex deliverMutex;
+
+			FrameHandler handler;
+
+			std::uint64_t nextSequence;
+			std::uint64_t deliverSequence;
+			std::uint64_t droppedFrames;
+
+			bool running;
+	};
+}
+
+#endif
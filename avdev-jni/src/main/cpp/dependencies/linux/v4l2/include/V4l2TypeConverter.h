@@ -22,6 +22,7 @@
 #include "PictureFormat.h"
 #include "PictureControl.h"
 #include "CameraControl.h"
+#include "ColorSpace.h"
 
 #include <algorithm>
 #include <unordered_map>
@@ -57,6 +58,8 @@ namespace avdev
 		
 		const std::uint32_t toApiType(const CameraControlType & type);
 
+		const ColorSpace toColorSpace(const struct v4l2_pix_format & format);
+
 	}
 }
 
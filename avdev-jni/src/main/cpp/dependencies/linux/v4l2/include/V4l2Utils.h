@@ -39,6 +39,9 @@ namespace avdev
 		
 		bool isV4l2Device(const char * name);
 		int ioctlDevice(int fh, int request, void *arg);
+
+		/* Like ioctlDevice(), but fails with EAGAIN instead of retrying, if a non-blocking device is not ready. */
+		int ioctlDeviceNoWait(int fh, int request, void * arg);
 		int openDevice(const char * path, int oflags);
 		int closeDevice(int fd);
 	}
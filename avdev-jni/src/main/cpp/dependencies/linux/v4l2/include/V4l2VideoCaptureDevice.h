@@ -21,6 +21,9 @@
 
 #include "VideoCaptureDevice.h"
 
+#include <mutex>
+#include <vector>
+
 namespace avdev
 {
 	class V4l2VideoCaptureDevice : public VideoCaptureDevice
@@ -33,6 +36,15 @@ namespace avdev
 			std::list<PictureControl> getPictureControls();
 			std::list<CameraControl> getCameraControls();
 
+			/* Continuous and stepwise ranges are reported by their bounds. */
+			std::vector<float> getFrameRates(const PictureFormat & format);
+
+			/*
+			 * Discards the probed formats, frame rates and controls, e.g. when
+			 * the driver reports a change. They are probed again on next query.
+			 */
+			void invalidateCapabilities();
+
 			void setPictureControlAutoMode(PictureControlType type, bool autoMode);
 			bool getPictureControlAutoMode(PictureControlType type);
 			void setPictureControlValue(PictureControlType type, long value);
@@ -52,7 +64,25 @@ namespace avdev
 			PVideoOutputStream createOutputStream(PVideoSink sink);
 
 		private:
+			/* A picture format and the frame rates the device captures it at. */
+			struct FormatCapability
+			{
+				PictureFormat format;
+				std::vector<float> frameRates;
+			};
+
+			/* Enumerates formats, frame sizes, frame intervals and controls once, to be called locked. */
+			void probeCapabilities();
+			void probeFormats();
+			void probeControls();
+
+			std::vector<float> probeFrameRates(std::uint32_t pixelFormat, unsigned width, unsigned height);
+
 			int v4l2_fd;
+
+			std::mutex capabilityMutex;
+			bool capabilitiesProbed;
+			std::vector<FormatCapability> formatCapabilities;
 	};
 }
 
@@ -43,6 +43,9 @@ namespace avdev
 			void addDevice(const char * name, const char * descriptor);
 			void removeDevice(const char * name, const char * descriptor);
 
+			/* Drops the cached capabilities of the device, they are probed again on next query. */
+			void changeDevice(const char * descriptor);
+
 		private:
 			struct udev * udev;
 	};
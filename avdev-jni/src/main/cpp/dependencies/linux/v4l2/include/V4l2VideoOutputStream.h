@@ -18,10 +18,16 @@
 #define AVDEV_V4l2_VIDEO_OUTPUT_STREAM_H_
 
 #include "avdev-v4l2.h"
+#include "AlignedBufferPool.h"
+#include "DmaBufVideoSink.h"
 #include "Thread.h"
 #include "VideoOutputStream.h"
 #include "JpegDecoder.h"
+#include "ParallelJpegDecoder.h"
 #include "PixelFormatConverter.h"
+#include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 
 namespace avdev
@@ -45,28 +51,132 @@ namespace avdev
 			void startInternal();
 			void stopInternal();
 
+			/* Keeps the device open and the buffers, if the device format is unchanged. */
+			void reconfigureInternal(bool started);
+
+			/* Applies the configuration to the stopped device and starts it again, if it was started. */
+			void reconfigureDevice(bool started);
+
 			void run();
 			int captureFrame();
 
-			void initBuffer(unsigned int pictureSize);
+			/* Requested picture format of the stream, as passed to the driver, which may adjust it to deviceFormat. */
+			struct v4l2_format getRequestedFormat();
+
+			/* Sets the format, which the driver may adjust, and keeps it as deviceFormat. */
+			void setDeviceFormat(struct v4l2_format & fmt);
+			void setDeviceFrameRate();
+
+			/*
+			 * Sets up decoding and conversion of the frames captured in deviceFormat.
+			 * Returns true, if the sink can share the captured buffers.
+			 */
+			bool initCapture();
+
+			/* Allocates the buffers for deviceFormat, exported as dmabuf for a sharing sink. */
+			void allocateBuffers(bool shareFrames);
+
+			/* Returns false, if the driver still holds the buffers, e.g. exported ones in use. */
+			bool releaseBuffers();
+
+			/* Closes and opens the device, if the buffers can't be released. */
+			void reopen(bool started);
+
+			/* Exportable buffers are mapped, otherwise user pointers are preferred. */
+			void initBuffer(unsigned int pictureSize, bool exportable);
+
+			/* Requests user pointer buffers from the pool. Returns false, if the driver does not support them. */
+			bool initUserBuffers(size_t size);
+
+			enum v4l2_memory getMemoryType() const;
+
+			/* Decodes and converts a captured frame, as required, and writes it to the sink. */
+			void processFrame(std::uint8_t * data, size_t length, const VideoFrameInfo & info);
+
+			/* Converts a decoded frame, as required, and writes it to the sink. */
+			void writeDecodedFrame(const std::uint8_t * data, size_t length, const VideoFrameInfo & info);
+
+			/* Converts a captured frame, which may have padded rows, and writes it to the sink. */
+			void writeConvertedFrame(const std::uint8_t * data, const VideoFrameInfo & info);
+
+			/* Exports the mapped buffers as dmabuf. Returns false, if the driver does not support it. */
+			bool exportBuffers();
+			void closeExportedBuffers();
+
+			/* Copies a buffer handed out as dmabuf to a pooled frame for the sinks attached with its format. */
+			void writeSharedFrameCopy(const struct v4l2_buffer & buf, const VideoFrameInfo & info);
+
+			/* Hands a dequeued buffer to the dmabuf sink, the buffer is requeued on release. */
+			void writeDmaBufFrame(const struct v4l2_buffer & buf, const VideoFrameInfo & info);
 
 			std::uint8_t * getBuffer(std::uint8_t index);
 			size_t getBufferSize(std::uint8_t index);
 
 		private:
+			/* Shared with the release callbacks of the frames handed out as dmabuf. */
+			struct BufferQueue
+			{
+				std::mutex mutex;
+				int fd;
+
+				/* Incremented when the buffers are released, frames of former buffers are not requeued. */
+				unsigned generation;
+				bool streaming;
+
+				/* Indices of the buffers held by the dmabuf sink, queued on release. */
+				std::set<unsigned> held;
+			};
+
+			/*
+			 * Descriptors of the exported buffers, shared with the frames handed out
+			 * as dmabuf. Closed once the stream and all held frames let go of them.
+			 */
+			struct ExportedBuffers
+			{
+				~ExportedBuffers();
+
+				std::vector<int> fds;
+			};
+
             std::shared_ptr<avdev::PixelFormatConverter> converter;
 
-			/* Two buffers should be sufficient. Back + Front buffer.*/
-			const int maxBuffers;
+			/* Format negotiated with the device. */
+			struct v4l2_pix_format deviceFormat;
+
+			/* Format and row stride in bytes of the captured frames. */
+			PictureFormat captureFormat;
+			std::size_t captureStride;
+			ColorSpace colorSpace;
+
+			/* Captured Motion-JPEG frames are decoded to the RGB24 or I420 captureFormat. */
+			bool decodeJpeg;
+
+			/* Set while started, if frames are captured by the shared CaptureReactor instead of the own thread. */
+			bool reactorCapture;
 
 			std::string devDescriptor;
 
 			v4l2::IOMethod ioMethod;
 			int v4l2_fd;
 
+			/* Frames read with the read() I/O method have no device sequence. */
+			std::uint32_t readSequence;
+
 			V4l2Buffers buffers;
+			AlignedBufferPool bufferPool;
+
+			/* Set, if the buffers were allocated for export. */
+			bool sharedBuffers;
 
 			JpegDecoder jpegDecoder;
+
+			/* Decodes on worker threads while the stream is started, if more than one decode thread is set. */
+			std::unique_ptr<ParallelJpegDecoder> parallelDecoder;
+
+			/* Set, if the sink receives the unconverted frames as dmabuf. */
+			std::shared_ptr<DmaBufVideoSink> dmaBufSink;
+			std::shared_ptr<ExportedBuffers> exportedBuffers;
+			std::shared_ptr<BufferQueue> bufferQueue;
 	};
 }
 
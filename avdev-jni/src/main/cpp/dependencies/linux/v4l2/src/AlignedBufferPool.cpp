@@ -0,0 +1,121 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AVdevException.h"
+#include "AlignedBufferPool.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace avdev
+{
+	/* Size of huge pages on x86-64 and most ARM64 kernels. */
+	static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	AlignedBufferPool::AlignedBufferPool()
+	{
+	}
+
+	AlignedBufferPool::~AlignedBufferPool()
+	{
+		clear();
+	}
+
+	void AlignedBufferPool::reserve(size_t count, size_t size)
+	{
+		while (blocks.size() > count) {
+			release(blocks.back());
+			blocks.pop_back();
+		}
+
+		for (Block & block : blocks) {
+			if (block.size < size) {
+				release(block);
+				block = allocate(size);
+			}
+		}
+
+		while (blocks.size() < count) {
+			blocks.push_back(allocate(size));
+		}
+	}
+
+	void AlignedBufferPool::clear()
+	{
+		for (Block & block : blocks) {
+			release(block);
+		}
+
+		blocks.clear();
+	}
+
+	std::uint8_t * AlignedBufferPool::getBuffer(size_t index) const
+	{
+		return blocks[index].data;
+	}
+
+	size_t AlignedBufferPool::getBufferSize(size_t index) const
+	{
+		return blocks[index].size;
+	}
+
+	size_t AlignedBufferPool::getBufferCount() const
+	{
+		return blocks.size();
+	}
+
+	AlignedBufferPool::Block AlignedBufferPool::allocate(size_t size)
+	{
+		void * data = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+		if (size >= HUGE_PAGE_SIZE) {
+			// Only succeeds, if huge pages have been reserved by the system.
+			size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+			data = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			if (data != MAP_FAILED) {
+				return Block { static_cast<std::uint8_t *>(data), hugeSize };
+			}
+		}
+#endif
+
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size = (size + pageSize - 1) & ~(pageSize - 1);
+
+		data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (data == MAP_FAILED) {
+			throw AVdevException("AlignedBufferPool: Failed to allocate %zu bytes.", size);
+		}
+
+#ifdef MADV_HUGEPAGE
+		// Transparent huge pages, if enabled for madvise.
+		madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+		return Block { static_cast<std::uint8_t *>(data), size };
+	}
+
+	void AlignedBufferPool::release(Block & block)
+	{
+		if (block.data != nullptr) {
+			munmap(block.data, block.size);
+			block.data = nullptr;
+		}
+	}
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AVdevException.h"
+#include "CaptureReactor.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace avdev
+{
+	/* Frames are mostly handed to the delivery queue or the decoder, a few threads serve many devices. */
+	static const unsigned DEFAULT_THREADS = 2;
+
+	/* Upper bound, as for the conversion thread pool. */
+	static const unsigned MAX_THREADS = 16;
+
+	CaptureReactor & CaptureReactor::instance()
+	{
+		static CaptureReactor instance;
+
+		return instance;
+	}
+
+	CaptureReactor::CaptureReactor() :
+		poolSize(DEFAULT_THREADS),
+		epollFd(epoll_create1(EPOLL_CLOEXEC)),
+		wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+	{
+		if (epollFd == -1 || wakeFd == -1) {
+			throw AVdevException("CaptureReactor: Failed to create epoll instance: %s.", strerror(errno));
+		}
+
+		struct epoll_event event = { 0 };
+		event.events = EPOLLIN;
+		event.data.fd = wakeFd;
+
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+	}
+
+	CaptureReactor::~CaptureReactor()
+	{
+		// The event stays signalled, every thread wakes up and returns.
+		std::uint64_t value = 1;
+
+		if (write(wakeFd, &value, sizeof(value)) == -1) {
+			LOGDEV_WARN("CaptureReactor: Failed to wake up threads: %s", strerror(errno));
+		}
+
+		for (std::thread & worker : workers) {
+			if (worker.joinable()) {
+				worker.join();
+			}
+		}
+
+		close(wakeFd);
+		close(epollFd);
+	}
+
+	void CaptureReactor::reserve(unsigned threads)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (threads > MAX_THREADS) {
+			threads = MAX_THREADS;
+		}
+
+		while (workers.size() < threads) {
+			workers.emplace_back(&CaptureReactor::run, this);
+		}
+	}
+
+	unsigned CaptureReactor::getThreadCount()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		return static_cast<unsigned>(workers.size());
+	}
+
+	void CaptureReactor::setPoolSize(unsigned threads)
+	{
+		bool started;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			poolSize = std::min(std::max(threads, 1u), MAX_THREADS);
+			started = !workers.empty();
+		}
+
+		if (started) {
+			reserve(threads);
+		}
+	}
+
+	unsigned CaptureReactor::getPoolSize()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		return poolSize;
+	}
+
+	void CaptureReactor::add(int fd, Handler handler)
+	{
+		unsigned threads;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			handlers[fd] = handler;
+			threads = poolSize;
+		}
+
+		// The pool does not grow with the devices.
+		reserve(threads);
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// One-shot, the device is rearmed when its handler has returned.
+		struct epoll_event event = { 0 };
+		event.events = EPOLLIN | EPOLLONESHOT;
+		event.data.fd = fd;
+
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+			handlers.erase(fd);
+
+			throw AVdevException("CaptureReactor: Failed to add device: %s.", strerror(errno));
+		}
+	}
+
+	void CaptureReactor::remove(int fd)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+		handlers.erase(fd);
+
+		auto running = busy.find(fd);
+
+		if (running != busy.end() && running->second != std::this_thread::get_id()) {
+			cond.wait(lock, [this, fd]() { return busy.find(fd) == busy.end(); });
+		}
+	}
+
+	void CaptureReactor::run()
+	{
+		while (true) {
+			struct epoll_event event;
+
+			int count = epoll_wait(epollFd, &event, 1, -1);
+
+			if (count == -1 && errno == EINTR) {
+				continue;
+			}
+			if (count == -1 || event.data.fd == wakeFd) {
+				return;
+			}
+
+			const int fd = event.data.fd;
+			Handler handler;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				auto entry = handlers.find(fd);
+
+				if (entry == handlers.end()) {
+					// Removed in the meantime.
+					continue;
+				}
+
+				handler = entry->second;
+				busy[fd] = std::this_thread::get_id();
+			}
+
+			bool keep = true;
+
+			// A failing frame must not end the thread, which captures for other devices as well.
+			try {
+				keep = handler();
+			}
+			catch (AVdevException & e) {
+				LOGDEV_ERROR("CaptureReactor: Capture failed for device %d: %s", fd, e.what());
+			}
+			catch (std::exception & e) {
+				LOGDEV_ERROR("CaptureReactor: Unhandled exception for device %d: %s", fd, e.what());
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				busy.erase(fd);
+
+				if (handlers.find(fd) != handlers.end()) {
+					if (keep) {
+						event.events = EPOLLIN | EPOLLONESHOT;
+						epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+					}
+					else {
+						epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+						handlers.erase(fd);
+					}
+				}
+			}
+
+			cond.notify_all();
+		}
+	}
+}
@@ -15,8 +15,10 @@
  */
 
 #include "AVdevException.h"
+#include "FrameView.h"
 #include "JpegDecoder.h"
 
+#include <algorithm>
 #include <cstring>
 
 /* Set up the standard Huffman tables (cf. JPEG standard section K.3) */
@@ -99,34 +101,122 @@ static const UINT8 val_ac_chrominance[] = {
 };
 
 
-struct ErrorManager : public jpeg_error_mgr {
-	jmp_buf jmpBuffer;
-};
-
-
 namespace avdev
 {
-	void JpegDecoder::transform(Bytes input, size_t inputSize, Bytes * output, size_t * outputSize)
+	/*
+	 * Writes one row of I420 chroma from a row pair of a decoded component.
+	 * Components with the full width of the frame are averaged over two
+	 * samples, distinct rows are averaged as well. The last sample of an odd
+	 * width is not paired.
+	 */
+	static void DownsampleChromaRow(const std::uint8_t * row0, const std::uint8_t * row1, bool fullWidth,
+		unsigned width, std::uint8_t * dest, unsigned count)
+	{
+		if (!fullWidth) {
+			if (row0 == row1) {
+				std::memcpy(dest, row0, count);
+			}
+			else {
+				for (unsigned x = 0; x < count; x++) {
+					dest[x] = static_cast<std::uint8_t>((row0[x] + row1[x] + 1) >> 1);
+				}
+			}
+			return;
+		}
+
+		const unsigned pairs = width / 2;
+
+		if (row0 == row1) {
+			for (unsigned x = 0; x < pairs; x++) {
+				dest[x] = static_cast<std::uint8_t>((row0[x * 2] + row0[x * 2 + 1] + 1) >> 1);
+			}
+		}
+		else {
+			for (unsigned x = 0; x < pairs; x++) {
+				dest[x] = static_cast<std::uint8_t>((row0[x * 2] + row0[x * 2 + 1] + row1[x * 2] + row1[x * 2 + 1] + 2) >> 2);
+			}
+		}
+
+		if (pairs < count) {
+			dest[pairs] = static_cast<std::uint8_t>((row0[pairs * 2] + row1[pairs * 2] + 1) >> 1);
+		}
+	}
+
+	/*
+	 * Sizes the buffer for an I420 frame and returns the view of its planes.
+	 * Errors of the decompressor longjmp over the locals of readRawData(), which
+	 * therefore must not have destructors, unlike PictureFormat.
+	 */
+	static FrameView MakeI420View(unsigned width, unsigned height, ByteBuffer & buffer)
+	{
+		const PictureFormat format(width, height, PixelFormat::I420);
+		const size_t size = GetFrameSize(format);
+
+		if (buffer.size() != size) {
+			buffer.resize(size);
+		}
+
+		return MakeFrameView(format, buffer.data());
+	}
+
+	/* Width of the decoded blocks of a component, less than DCTSIZE when scaling. */
+	static int ScaledBlockWidth(const jpeg_component_info & info)
+	{
+#if JPEG_LIB_VERSION >= 70
+		return info.DCT_h_scaled_size;
+#else
+		return info.DCT_scaled_size;
+#endif
+	}
+
+	/* Height of the decoded blocks of a component, less than DCTSIZE when scaling. */
+	static int ScaledBlockHeight(const jpeg_component_info & info)
+	{
+#if JPEG_LIB_VERSION >= 70
+		return info.DCT_v_scaled_size;
+#else
+		return info.DCT_scaled_size;
+#endif
+	}
+
+	JpegDecoder::JpegDecoder(J_DCT_METHOD dctMethod) :
+		dctMethod(dctMethod),
+		outputFormat(PixelFormat::RGB24),
+		scale(1)
 	{
-		jpeg_decompress_struct decompress;
-		ErrorManager error;
-		
 		decompress.err = jpeg_std_error(&error);
-		
+
 		error.error_exit = JpegDecoder::onError;
 		error.output_message = JpegDecoder::onOutputMessage;
-		
+
 		jpeg_create_decompress(&decompress);
-		
+	}
+
+	JpegDecoder::~JpegDecoder()
+	{
+		jpeg_destroy_decompress(&decompress);
+	}
+
+	void JpegDecoder::transform(Bytes input, size_t inputSize, Bytes * output, size_t * outputSize)
+	{
+		if (!isComplete(input, inputSize)) {
+			throw AVdevException("JpegDecoder: Incomplete frame.");
+		}
+
+		char message[JMSG_LENGTH_MAX];
+
 		if (setjmp(error.jmpBuffer)) {
-			jpeg_destroy_decompress(&decompress);
-			throw AVdevException("JpegDecoder: Error.");
+			decompress.err->format_message(reinterpret_cast<j_common_ptr>(&decompress), message);
+
+			// Resets the decompressor, it remains usable for the next frame.
+			jpeg_abort_decompress(&decompress);
+			throw AVdevException("JpegDecoder: %s.", message);
 		}
 		
-		jpeg_mem_src(&decompress, input, inputSize);
+		jpeg_mem_src(&decompress, input, static_cast<unsigned long>(inputSize));
 		
 		if (jpeg_read_header(&decompress, TRUE) != JPEG_HEADER_OK) {
-			jpeg_destroy_decompress(&decompress);
+			jpeg_abort_decompress(&decompress);
 			throw AVdevException("JpegDecoder: Read header failed.");
 		}
 		
@@ -135,42 +225,271 @@ namespace avdev
 			addDHT(&decompress);
 		}
 		
-		decompress.dct_method = JDCT_FLOAT;
-		decompress.out_color_space = JCS_RGB;
+		decompress.dct_method = dctMethod;
+		decompress.scale_num = 1;
+		decompress.scale_denom = scale;
+
+		if (outputFormat == PixelFormat::I420) {
+			if (decompress.jpeg_color_space != JCS_YCbCr && decompress.jpeg_color_space != JCS_GRAYSCALE) {
+				jpeg_abort_decompress(&decompress);
+				throw AVdevException("JpegDecoder: Color space %d cannot be decoded to I420.",
+					static_cast<int>(decompress.jpeg_color_space));
+			}
+
+			decompress.raw_data_out = TRUE;
+			decompress.out_color_space = decompress.jpeg_color_space;
+		}
+		else {
+			decompress.raw_data_out = FALSE;
+			decompress.out_color_space = JCS_RGB;
+		}
 		
 		if (!jpeg_start_decompress(&decompress)) {
-			jpeg_destroy_decompress(&decompress);
+			jpeg_abort_decompress(&decompress);
 			throw AVdevException("JpegDecoder: Start decompress failed.");
 		}
 
+		if (outputFormat == PixelFormat::I420) {
+			readRawData();
+		}
+		else {
+			readScanlines();
+		}
+		
+		*output = buffer.data();
+		*outputSize = buffer.size();
+
+		jpeg_finish_decompress(&decompress);
+	}
+
+	void JpegDecoder::setDctMethod(J_DCT_METHOD method)
+	{
+		dctMethod = method;
+	}
+
+	J_DCT_METHOD JpegDecoder::getDctMethod() const
+	{
+		return dctMethod;
+	}
+
+	void JpegDecoder::setOutputFormat(PixelFormat format)
+	{
+		if (format != PixelFormat::RGB24 && format != PixelFormat::I420) {
+			throw AVdevException("JpegDecoder: Output format %s not supported.",
+				PixelFormatToString(format).c_str());
+		}
+
+		outputFormat = format;
+	}
+
+	PixelFormat JpegDecoder::getOutputFormat() const
+	{
+		return outputFormat;
+	}
+
+	void JpegDecoder::setScale(unsigned scale)
+	{
+		if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+			throw AVdevException("JpegDecoder: Scale 1/%u not supported.", scale);
+		}
+
+		this->scale = scale;
+	}
+
+	unsigned JpegDecoder::getScale() const
+	{
+		return scale;
+	}
+
+	unsigned JpegDecoder::selectScale(unsigned width, unsigned height, unsigned minWidth, unsigned minHeight)
+	{
+		unsigned scale = 8;
+
+		while (scale > 1 && (scaleSize(width, scale) < minWidth || scaleSize(height, scale) < minHeight)) {
+			scale /= 2;
+		}
+
+		return scale;
+	}
+
+	unsigned JpegDecoder::scaleSize(unsigned size, unsigned scale)
+	{
+		// Rounded up, as by the decompressor.
+		return (size + scale - 1) / scale;
+	}
+
+	void JpegDecoder::readScanlines()
+	{
 		const size_t stride = decompress.output_width * decompress.output_components;
-		const unsigned size = decompress.output_height * stride;
+		const size_t size = decompress.output_height * stride;
 		
-		if (buffer.size() != size) {
+		if (buffer.size() != size || rows.size() != decompress.output_height) {
 			buffer.resize(size);
+			rows.resize(decompress.output_height);
+
+			for (size_t i = 0; i < rows.size(); i++) {
+				rows[i] = buffer.data() + i * stride;
+			}
 		}
 		
-		JSAMPROW outPtr = buffer.data();
-		size_t decompressed = 0;
-		
-        while (decompress.output_scanline < decompress.output_height) {
-            if (jpeg_read_scanlines(&decompress, &outPtr, 1) != 1) {
-				break;
+		while (decompress.output_scanline < decompress.output_height) {
+			JDIMENSION scanline = decompress.output_scanline;
+
+			if (jpeg_read_scanlines(&decompress, rows.data() + scanline, decompress.output_height - scanline) == 0) {
+				jpeg_abort_decompress(&decompress);
+				throw AVdevException("JpegDecoder: Read scanlines failed.");
 			}
+		}
+	}
 
-            outPtr += stride;
-			decompressed += stride;
-        }
-		
-		*output = buffer.data();
-		*outputSize = decompressed;
+	void JpegDecoder::readRawData()
+	{
+		const unsigned width = decompress.output_width;
+		const unsigned height = decompress.output_height;
+		const int components = std::min(decompress.num_components, 3);
+		const jpeg_component_info * info = decompress.comp_info;
 
-		jpeg_finish_decompress(&decompress);
-		jpeg_destroy_decompress(&decompress);
+		// Samples of each component per iMCU. With scaling the decompressor may
+		// choose larger blocks for chroma, so that the resolution ratio differs
+		// from the sampling factors.
+		int columns[3] = { 0 };
+		int rowCounts[3] = { 0 };
+
+		for (int c = 0; c < components; c++) {
+			columns[c] = info[c].h_samp_factor * ScaledBlockWidth(info[c]);
+			rowCounts[c] = info[c].v_samp_factor * ScaledBlockHeight(info[c]);
+		}
+
+		// Chroma must have the luma resolution or half of it.
+		bool supported = true;
+
+		for (int c = 1; c < components; c++) {
+			supported &= (columns[c] == columns[1] && rowCounts[c] == rowCounts[1]);
+			supported &= (columns[0] == columns[c] || columns[0] == columns[c] * 2);
+			supported &= (rowCounts[0] == rowCounts[c] || rowCounts[0] == rowCounts[c] * 2);
+		}
+
+		if (!supported) {
+			jpeg_abort_decompress(&decompress);
+			throw AVdevException("JpegDecoder: Chroma subsampling not supported.");
+		}
+
+		const FrameView view = MakeI420View(width, height, buffer);
+
+		// Chroma rows are averaged in pairs, an odd number of rows per iMCU is
+		// read two iMCU rows at a time.
+		const int batches = (rowCounts[0] % 2 != 0) ? 2 : 1;
+
+		// Decoded components are padded to whole blocks.
+		size_t rawStride[3];
+		size_t rawOffset[3];
+		size_t rawSize = 0;
+		size_t rowCount = 0;
+
+		for (int c = 0; c < components; c++) {
+			rawStride[c] = info[c].width_in_blocks * ScaledBlockWidth(info[c]);
+			rawOffset[c] = rawSize;
+			rawSize += rawStride[c] * rowCounts[c] * batches;
+			rowCount += rowCounts[c] * batches;
+		}
+
+		if (rawBuffer.size() != rawSize || rawRows.size() != rowCount) {
+			rawBuffer.resize(rawSize);
+			rawRows.resize(rowCount);
+
+			JSAMPROW * row = rawRows.data();
+
+			for (int c = 0; c < components; c++) {
+				for (int i = 0; i < rowCounts[c] * batches; i++) {
+					*row++ = rawBuffer.data() + rawOffset[c] + i * rawStride[c];
+				}
+			}
+		}
+
+		JSAMPARRAY planes[3];
+		JSAMPROW * row = rawRows.data();
+
+		for (int c = 0; c < components; c++) {
+			planes[c] = row;
+			row += rowCounts[c] * batches;
+		}
+
+		const unsigned chromaWidth = (width + 1) / 2;
+		const unsigned chromaHeight = (height + 1) / 2;
+		const JDIMENSION mcuRows = rowCounts[0];
+
+		if (components == 1) {
+			// Grayscale.
+			std::memset(view.data[1], 128, chromaWidth * chromaHeight);
+			std::memset(view.data[2], 128, chromaWidth * chromaHeight);
+		}
+
+		while (decompress.output_scanline < height) {
+			const unsigned y = decompress.output_scanline;
+
+			for (int b = 0; b < batches && decompress.output_scanline < height; b++) {
+				JSAMPARRAY batch[3];
+
+				for (int c = 0; c < components; c++) {
+					batch[c] = planes[c] + b * rowCounts[c];
+				}
+
+				if (jpeg_read_raw_data(&decompress, batch, mcuRows) == 0) {
+					jpeg_abort_decompress(&decompress);
+					throw AVdevException("JpegDecoder: Read raw data failed.");
+				}
+			}
+
+			const unsigned lumaRows = std::min<unsigned>(mcuRows * batches, height - y);
+
+			for (unsigned i = 0; i < lumaRows; i++) {
+				std::memcpy(view.data[0] + (y + i) * view.stride[0], planes[0][i], width);
+			}
+
+			if (components == 1) {
+				continue;
+			}
+
+			// A batch has an even number of luma rows.
+			const bool fullWidth = (columns[1] == columns[0]);
+			const bool fullHeight = (rowCounts[1] == rowCounts[0]);
+
+			for (unsigned i = 0; i < (lumaRows + 1) / 2; i++) {
+				unsigned row0 = i;
+				unsigned row1 = i;
+
+				if (fullHeight) {
+					row0 = i * 2;
+					row1 = (row0 + 1 < lumaRows) ? row0 + 1 : row0;
+				}
+
+				const unsigned destRow = y / 2 + i;
+
+				DownsampleChromaRow(planes[1][row0], planes[1][row1], fullWidth, width,
+					view.data[1] + destRow * view.stride[1], chromaWidth);
+				DownsampleChromaRow(planes[2][row0], planes[2][row1], fullWidth, width,
+					view.data[2] + destRow * view.stride[2], chromaWidth);
+			}
+		}
+	}
+
+	bool JpegDecoder::isComplete(const std::uint8_t * data, size_t size)
+	{
+		if (data == nullptr || size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+			return false;
+		}
+
+		// Skip the zero padding behind the EOI marker.
+		while (size > 4 && data[size - 1] == 0x00) {
+			size--;
+		}
+
+		return data[size - 2] == 0xFF && data[size - 1] == 0xD9;
 	}
 	
 	void JpegDecoder::onError(j_common_ptr info)
 	{
+		// Returns to transform(), the skipped frames have no locals with destructors.
 		ErrorManager * error = (ErrorManager *) info->err;
 		longjmp(error->jmpBuffer, 1);
 	}
@@ -194,8 +513,15 @@ namespace avdev
 			*table = jpeg_alloc_huff_table((j_common_ptr) decompress);
 		}
 
+		// The number of values is the sum of the code counts per length.
+		size_t count = 0;
+
+		for (int i = 1; i < 17; i++) {
+			count += bits[i];
+		}
+
 		std::memcpy((*table)->bits, bits, sizeof((*table)->bits));
-		std::memcpy((*table)->huffval, values, sizeof((*table)->huffval));
+		std::memcpy((*table)->huffval, values, count);
 
 		(*table)->sent_table = FALSE;
 	}
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2016 Alex Andres
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AVdevException.h"
+#include "Log.h"
+#include "ParallelJpegDecoder.h"
+
+#include <cstring>
+
+namespace avdev
+{
+	ParallelJpegDecoder::ParallelJpegDecoder(unsigned threads, PixelFormat outputFormat, unsigned scale, FrameHandler handler) :
+		handler(handler),
+		nextSequence(0),
+		deliverSequence(0),
+		droppedFrames(0),
+		running(true)
+	{
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		for (unsigned i = 0; i < threads * 2; i++) {
+			std::unique_ptr<Slot> slot(new Slot());
+			slot->decoder.setOutputFormat(outputFormat);
+			slot->decoder.setScale(scale);
+			slot->inputSize = 0;
+			slot->output = nullptr;
+			slot->outputSize = 0;
+			slot->sequence = 0;
+			slot->state = SlotState::FREE;
+
+			slots.push_back(std::move(slot));
+		}
+
+		for (unsigned i = 0; i < threads; i++) {
+			workers.emplace_back(&ParallelJpegDecoder::run, this);
+		}
+	}
+
+	ParallelJpegDecoder::~ParallelJpegDecoder()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			running = false;
+		}
+
+		cond.notify_all();
+
+		for (std::thread & worker : workers) {
+			if (worker.joinable()) {
+				worker.join();
+			}
+		}
+	}
+
+	bool ParallelJpegDecoder::push(const std::uint8_t * data, size_t length, const VideoFrameInfo & info)
+	{
+		Slot * slot = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			for (auto & s : slots) {
+				if (s->state == SlotState::FREE) {
+					slot = s.get();
+					break;
+				}
+			}
+
+			if (slot == nullptr) {
+				droppedFrames++;
+				return false;
+			}
+
+			slot->state = SlotState::FILLING;
+		}
+
+		// Copy outside of the lock, the workers keep on decoding.
+		if (slot->input.size() < length) {
+			slot->input.resize(length);
+		}
+
+		std::memcpy(slot->input.data(), data, length);
+		slot->inputSize = length;
+		slot->info = info;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			slot->sequence = nextSequence++;
+			slot->state = SlotState::QUEUED;
+
+			queue.push_back(slot);
+		}
+
+		cond.notify_one();
+
+		return true;
+	}
+
+	std::uint64_t ParallelJpegDecoder::getDroppedFrames()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		return droppedFrames;
+	}
+
+	void ParallelJpegDecoder::run()
+	{
+		while (true) {
+			Slot * slot;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				cond.wait(lock, [this]() { return !running || !queue.empty(); });
+
+				// Frames in flight are decoded and delivered before stopping.
+				if (!running && queue.empty()) {
+					return;
+				}
+
+				slot = queue.front();
+				slot->state = SlotState::DECODING;
+
+				queue.pop_front();
+			}
+
+			SlotState state = SlotState::DECODED;
+
+			try {
+				slot->decoder.transform(slot->input.data(), slot->inputSize, &slot->output, &slot->outputSize);
+			}
+			catch (AVdevException & e) {
+				LOGDEV_WARN("ParallelJpegDecoder: Dropped frame: %s", e.what());
+
+				state = SlotState::FAILED;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				slot->state = state;
+			}
+
+			deliver();
+		}
+	}
+
+	void ParallelJpegDecoder::deliver()
+	{
+		std::unique_lock<std::mutex> deliverLock(deliverMutex);
+
+		while (true) {
+			Slot * next = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				for (auto & s : slots) {
+					if (s->sequence == deliverSequence &&
+						(s->state == SlotState::DECODED || s->state == SlotState::FAILED))
+					{
+						next = s.get();
+						break;
+					}
+				}
+			}
+
+			if (next == nullptr) {
+				return;
+			}
+
+			if (next->state == SlotState::DECODED) {
+				try {
+					handler(next->output, next->outputSize, next->info);
+				}
+				catch (AVdevException & e) {
+					LOGDEV_WARN("ParallelJpegDecoder: Failed to deliver frame: %s", e.what());
+				}
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				next->state = SlotState::FREE;
+				deliverSequence++;
+			}
+		}
+	}
+}
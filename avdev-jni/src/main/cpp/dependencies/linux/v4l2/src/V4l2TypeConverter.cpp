@@ -110,6 +110,7 @@ namespace avdev
 			{ V4L2_PIX_FMT_YVU420,  PixelFormat::YVU420 },
 			{ V4L2_PIX_FMT_YUYV,    PixelFormat::YUYV },
 			{ V4L2_PIX_FMT_UYVY,    PixelFormat::UYVY },
+			{ V4L2_PIX_FMT_YVYU,    PixelFormat::YVYU },
 			{ V4L2_PIX_FMT_YUV422P, PixelFormat::YUV422P },
 			{ V4L2_PIX_FMT_YUV411P, PixelFormat::YUV411P },
 			{ V4L2_PIX_FMT_Y41P,    PixelFormat::Y41P },
@@ -195,5 +196,28 @@ namespace avdev
 			return got->first;
 		}
 
+		const ColorSpace toColorSpace(const struct v4l2_pix_format & format)
+		{
+			std::uint32_t encoding = V4L2_YCBCR_ENC_DEFAULT;
+			std::uint32_t quantization = V4L2_QUANTIZATION_DEFAULT;
+
+			// The extended fields are only valid if the driver sets the magic value.
+			if (format.priv == V4L2_PIX_FMT_PRIV_MAGIC) {
+				encoding = format.ycbcr_enc;
+				quantization = format.quantization;
+			}
+			if (encoding == V4L2_YCBCR_ENC_DEFAULT) {
+				encoding = V4L2_MAP_YCBCR_ENC_DEFAULT(format.colorspace);
+			}
+			if (quantization == V4L2_QUANTIZATION_DEFAULT) {
+				quantization = V4L2_MAP_QUANTIZATION_DEFAULT(false, format.colorspace, encoding);
+			}
+
+			bool bt709 = (encoding == V4L2_YCBCR_ENC_709 || encoding == V4L2_YCBCR_ENC_XV709);
+			bool fullRange = (quantization == V4L2_QUANTIZATION_FULL_RANGE);
+
+			return ColorSpace(bt709 ? YuvMatrix::BT709 : YuvMatrix::BT601, fullRange ? YuvRange::Full : YuvRange::Limited);
+		}
+
 	}
 }
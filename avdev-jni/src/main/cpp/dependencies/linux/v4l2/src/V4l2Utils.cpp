@@ -37,6 +37,18 @@ namespace avdev
 
 			return r;
 		}
+
+		int ioctlDeviceNoWait(int fh, int request, void * arg)
+		{
+			int r;
+
+			do {
+				r = ioctl(fh, request, arg);
+			}
+			while (-1 == r && errno == EINTR);
+
+			return r;
+		}
 		
 		int openDevice(const char * path, int oflags)
 		{
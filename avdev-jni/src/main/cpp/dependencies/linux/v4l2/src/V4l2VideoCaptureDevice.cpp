@@ -19,10 +19,53 @@
 #include "V4l2VideoOutputStream.h"
 #include "V4l2TypeConverter.h"
 
+#include <algorithm>
+
 namespace avdev
 {
+	static float ToFrameRate(const struct v4l2_fract & interval)
+	{
+		if (interval.numerator == 0) {
+			return 0;
+		}
+
+		return static_cast<float>(interval.denominator) / interval.numerator;
+	}
+
+	/*
+	 * Adds the control or merges it with the one of the same type, e.g. V4L2_CID_HUE
+	 * and V4L2_CID_HUE_AUTO, into a control with auto-mode.
+	 */
+	template <typename Control, typename Type>
+	static void MergeControl(std::list<Control> & controls, Type type, const struct v4l2_queryctrl & queryctrl, bool autoMode)
+	{
+		for (auto itr = controls.begin(); itr != controls.end(); ++itr) {
+			if ((*itr).getType() == type) {
+				Control ctrl = (*itr);
+
+				if (!(*itr).hasAutoMode()) {
+					ctrl = Control(type, (*itr).getMinValue(), (*itr).getMaxValue(),
+						(*itr).getStepValue(), (*itr).getDefaultValue(), true);
+				}
+				else {
+					ctrl = Control(type, queryctrl.minimum, queryctrl.maximum,
+						queryctrl.step, queryctrl.default_value, true);
+				}
+
+				// Replace control.
+				controls.erase(itr);
+				controls.push_back(ctrl);
+				return;
+			}
+		}
+
+		controls.push_back(Control(type, queryctrl.minimum, queryctrl.maximum,
+			queryctrl.step, queryctrl.default_value, autoMode));
+	}
+
 	V4l2VideoCaptureDevice::V4l2VideoCaptureDevice(std::string name, std::string descriptor)
-		: VideoCaptureDevice(name, descriptor)
+		: VideoCaptureDevice(name, descriptor),
+		capabilitiesProbed(false)
 	{
 		v4l2_fd = v4l2::openDevice(getDescriptor().c_str(), O_RDONLY);
 		if (v4l2_fd < 0) {
@@ -37,62 +80,176 @@ namespace avdev
 
 	std::list<PictureFormat> V4l2VideoCaptureDevice::getPictureFormats()
 	{
-		if (formats.empty()) {
-			struct v4l2_capability vcap = { 0 };
+		std::unique_lock<std::mutex> lock(capabilityMutex);
+
+		probeCapabilities();
+
+		return formats;
+	}
+
+	std::list<PictureControl> V4l2VideoCaptureDevice::getPictureControls()
+	{
+		std::unique_lock<std::mutex> lock(capabilityMutex);
+
+		probeCapabilities();
+
+		return pictureControls;
+	}
+
+	std::list<CameraControl> V4l2VideoCaptureDevice::getCameraControls()
+	{
+		std::unique_lock<std::mutex> lock(capabilityMutex);
+
+		probeCapabilities();
+
+		return cameraControls;
+	}
 
-			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QUERYCAP, &vcap) == -1) {
-				throw AVdevException("V4l2: Failed to query device: %s.", getName().c_str());
+	std::vector<float> V4l2VideoCaptureDevice::getFrameRates(const PictureFormat & format)
+	{
+		std::unique_lock<std::mutex> lock(capabilityMutex);
+
+		probeCapabilities();
+
+		for (const FormatCapability & capability : formatCapabilities) {
+			if (capability.format == format) {
+				return capability.frameRates;
 			}
+		}
 
-			struct v4l2_fmtdesc fmt = { 0 };
-			struct v4l2_frmsizeenum frameSize = { 0 };
+		return std::vector<float>();
+	}
 
-			fmt.index = 0;
-			fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			
-			while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_ENUM_FMT, &fmt) >= 0) {
-				PixelFormat pixFormat = V4l2TypeConverter::toPixelFormat(fmt.pixelformat);
-
-				frameSize.pixel_format = fmt.pixelformat;
-				frameSize.index = 0;
-				
-				while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) > -1) {
-					if (frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
-						PictureFormat format(frameSize.discrete.width, frameSize.discrete.height, pixFormat);
-						formats.push_back(format);
-					}
-					else if (frameSize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
-						PictureFormat format(frameSize.stepwise.max_width, frameSize.stepwise.max_height, pixFormat);
-						formats.push_back(format);
-					}
-					frameSize.index++;
+	void V4l2VideoCaptureDevice::invalidateCapabilities()
+	{
+		std::unique_lock<std::mutex> lock(capabilityMutex);
+
+		capabilitiesProbed = false;
+	}
+
+	void V4l2VideoCaptureDevice::probeCapabilities()
+	{
+		if (capabilitiesProbed) {
+			return;
+		}
+
+		probeFormats();
+		probeControls();
+
+		capabilitiesProbed = true;
+	}
+
+	void V4l2VideoCaptureDevice::probeFormats()
+	{
+		struct v4l2_capability vcap = { 0 };
+
+		if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QUERYCAP, &vcap) == -1) {
+			throw AVdevException("V4l2: Failed to query device: %s.", getName().c_str());
+		}
+
+		formats.clear();
+		formatCapabilities.clear();
+
+		struct v4l2_fmtdesc fmt = { 0 };
+		struct v4l2_frmsizeenum frameSize = { 0 };
+
+		fmt.index = 0;
+		fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+		while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_ENUM_FMT, &fmt) >= 0) {
+			PixelFormat pixFormat = V4l2TypeConverter::toPixelFormat(fmt.pixelformat);
+
+			frameSize.pixel_format = fmt.pixelformat;
+			frameSize.index = 0;
+
+			while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) > -1) {
+				unsigned width = 0;
+				unsigned height = 0;
+
+				if (frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+					width = frameSize.discrete.width;
+					height = frameSize.discrete.height;
+				}
+				else if (frameSize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
+					width = frameSize.stepwise.max_width;
+					height = frameSize.stepwise.max_height;
+				}
+
+				if (width > 0 && height > 0) {
+					PictureFormat format(width, height, pixFormat);
+
+					formats.push_back(format);
+					formatCapabilities.push_back({ format, probeFrameRates(fmt.pixelformat, width, height) });
 				}
-				fmt.index++;
+
+				frameSize.index++;
 			}
+			fmt.index++;
 		}
-		
-		return formats;
 	}
-	
-	std::list<PictureControl> V4l2VideoCaptureDevice::getPictureControls()
+
+	std::vector<float> V4l2VideoCaptureDevice::probeFrameRates(std::uint32_t pixelFormat, unsigned width, unsigned height)
 	{
-		std::list<PictureControl> controls;
+		std::vector<float> frameRates;
+
+		struct v4l2_frmivalenum interval = { 0 };
+		interval.pixel_format = pixelFormat;
+		interval.width = width;
+		interval.height = height;
+		interval.index = 0;
+
+		while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0) {
+			if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+				frameRates.push_back(ToFrameRate(interval.discrete));
+			}
+			else {
+				// Continuous and stepwise ranges are reported once, by their bounds.
+				frameRates.push_back(ToFrameRate(interval.stepwise.max));
+				frameRates.push_back(ToFrameRate(interval.stepwise.min));
+				break;
+			}
+
+			interval.index++;
+		}
+
+		frameRates.erase(std::remove(frameRates.begin(), frameRates.end(), 0.f), frameRates.end());
+
+		std::sort(frameRates.begin(), frameRates.end());
+
+		frameRates.erase(std::unique(frameRates.begin(), frameRates.end()), frameRates.end());
+
+		return frameRates;
+	}
+
+	void V4l2VideoCaptureDevice::probeControls()
+	{
+		pictureControls.clear();
+		cameraControls.clear();
 
 		struct v4l2_queryctrl queryctrl = { 0 };
 
-		for (queryctrl.id = V4L2_CID_USER_BASE; queryctrl.id < V4L2_CID_LASTP1; queryctrl.id++) {
-			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QUERYCTRL, &queryctrl) == 0) {
-				if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) {
+		// Walks the controls of all classes the driver implements, instead of querying each id.
+		queryctrl.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+
+		while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QUERYCTRL, &queryctrl) == 0) {
+			std::uint32_t id = queryctrl.id;
+
+			queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+
+			if ((queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) || queryctrl.type == V4L2_CTRL_TYPE_CTRL_CLASS) {
+				continue;
+			}
+
+			if (V4L2_CTRL_ID2CLASS(id) == V4L2_CTRL_CLASS_USER) {
+				// Driver private controls follow the predefined ones.
+				if (id >= V4L2_CID_LASTP1) {
 					continue;
 				}
-				
-				//printf("%s %d \n", queryctrl.name, queryctrl.id);
 
 				PictureControlType type;
 				bool autoMode = false;
-				bool changed = false;
 
-				switch (queryctrl.id) {
+				switch (id) {
 					case V4L2_CID_AUTOGAIN:
 						type = PictureControlType::Gain;
 						autoMode = true;
@@ -105,126 +262,38 @@ namespace avdev
 						type = PictureControlType::WhiteBalance;
 						autoMode = true;
 						break;
-						
+
 					default:
-						type = V4l2TypeConverter::toPictureControlType(queryctrl.id);
+						type = V4l2TypeConverter::toPictureControlType(id);
 				}
 
-				for (std::list<PictureControl>::iterator itr = controls.begin(); itr != controls.end();) {
-					if ((*itr).getType() == type) {
-						// Merge controls of same type into one, e.g. V4L2_CID_HUE and V4L2_CID_HUE_AUTO.
-						PictureControl ctrl(PictureControlType::NotImplemented, 0, 0, 0, 0, false);
-
-						if (!(*itr).hasAutoMode()) {
-							ctrl = PictureControl(type, (*itr).getMinValue(), (*itr).getMaxValue(),
-								(*itr).getStepValue(), (*itr).getDefaultValue(), true);
-						}
-						else {
-							ctrl = PictureControl(type, queryctrl.minimum, queryctrl.maximum,
-								queryctrl.step, queryctrl.default_value, true);
-						}
-
-						// Replace control.
-						itr = controls.erase(itr);
-						controls.push_back(ctrl);
-
-						changed = true;
-						break;
-					}
-					++itr;
-				}
+				MergeControl(pictureControls, type, queryctrl, autoMode);
+			}
+			else if (V4L2_CTRL_ID2CLASS(id) == V4L2_CTRL_CLASS_CAMERA) {
+				CameraControlType type;
+				bool autoMode = false;
 
-				if (!changed) {
-					PictureControl ctrl = PictureControl(type, queryctrl.minimum, queryctrl.maximum,
-						queryctrl.step, queryctrl.default_value, autoMode);
+				switch (id) {
+					case V4L2_CID_EXPOSURE_AUTO:
+						type = CameraControlType::Exposure;
+						autoMode = true;
+						break;
+					case V4L2_CID_FOCUS_AUTO:
+						type = CameraControlType::Focus;
+						autoMode = true;
+						break;
 
-					controls.push_back(ctrl);
-				}
-			}
-			else {
-				if (errno == EINVAL) {
-					continue;
+					default:
+						type = V4l2TypeConverter::toCameraControlType(id);
 				}
 
-				throw AVdevException("V4l2: Query camera control failed: %s.", getName().c_str());
+				MergeControl(cameraControls, type, queryctrl, autoMode);
 			}
 		}
-		
-		return controls;
-	}
 
-	std::list<CameraControl> V4l2VideoCaptureDevice::getCameraControls()
-	{
-		std::list<CameraControl> controls;
-		
-		struct v4l2_queryctrl queryctrl = { 0 };
-		
-		queryctrl.id = V4L2_CTRL_CLASS_CAMERA | V4L2_CTRL_FLAG_NEXT_CTRL;
-		
-		while (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QUERYCTRL, &queryctrl) == 0) {
-			if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED) {
-				continue;
-			}
-			if (queryctrl.id == V4L2_CID_JPEG_CLASS) {
-				queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
-				continue;
-			}
-
-			//printf("%s %x \n", queryctrl.name, queryctrl.id);
-
-			CameraControlType type;
-			bool autoMode = false;
-			bool changed = false;
-
-			switch (queryctrl.id) {
-				case V4L2_CID_EXPOSURE_AUTO:
-					type = CameraControlType::Exposure;
-					autoMode = true;
-					break;
-				case V4L2_CID_FOCUS_AUTO:
-					type = CameraControlType::Focus;
-					autoMode = true;
-					break;
-					
-				default:
-					type = V4l2TypeConverter::toCameraControlType(queryctrl.id);
-			}
-
-			for (std::list<CameraControl>::iterator itr = controls.begin(); itr != controls.end();) {
-				if ((*itr).getType() == type) {
-					// Merge controls of same type into one, e.g. V4L2_CID_FOCUS_* and V4L2_CID_FOCUS_AUTO.
-					CameraControl ctrl(CameraControlType::NotImplemented, 0, 0, 0, 0, false);
-
-					if (!(*itr).hasAutoMode()) {
-						ctrl = CameraControl(type, (*itr).getMinValue(), (*itr).getMaxValue(),
-							(*itr).getStepValue(), (*itr).getDefaultValue(), true);
-					}
-					else {
-						ctrl = CameraControl(type, queryctrl.minimum, queryctrl.maximum,
-							queryctrl.step, queryctrl.default_value, true);
-					}
-
-					// Replace control.
-					itr = controls.erase(itr);
-					controls.push_back(ctrl);
-
-					changed = true;
-					break;
-				}
-				++itr;
-			}
-
-			if (!changed) {
-				CameraControl ctrl = CameraControl(type, queryctrl.minimum, queryctrl.maximum,
-					queryctrl.step, queryctrl.default_value, autoMode);
-
-				controls.push_back(ctrl);
-			}
-			
-			queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+		if (errno != EINVAL) {
+			throw AVdevException("V4l2: Query controls failed: %s.", getName().c_str());
 		}
-		
-		return controls;
 	}
 
 	void V4l2VideoCaptureDevice::setPictureControlAutoMode(PictureControlType type, bool autoMode)
@@ -90,6 +90,9 @@ namespace avdev
 				else if (strcmp(action, UDEV_REMOVE) == 0) {
 					removeDevice(name, node);
 				}
+				else if (strcmp(action, UDEV_CHANGE) == 0) {
+					changeDevice(node);
+				}
 
 				udev_device_unref(dev);
 			}
@@ -185,4 +188,19 @@ namespace avdev
 			notifyDeviceDisconnected(removed);
 		}
 	}
+
+	void V4l2VideoManager::changeDevice(const char * descriptor)
+	{
+		std::string desc(descriptor);
+
+		auto predicate = [desc](const PVideoCaptureDevice & dev) {
+			return desc == dev->getDescriptor();
+		};
+
+		auto device = std::dynamic_pointer_cast<V4l2VideoCaptureDevice>(captureDevices.findDevice(predicate));
+
+		if (device) {
+			device->invalidateCapabilities();
+		}
+	}
 }
@@ -15,17 +15,59 @@
  */
 
 #include "AVdevException.h"
+#include "CaptureReactor.h"
 #include "V4l2VideoOutputStream.h"
 #include "V4l2TypeConverter.h"
 #include "Log.h"
 
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
 namespace avdev {
 
+	static std::int64_t MonotonicTime()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+
+	static VideoFrameInfo GetFrameInfo(const struct v4l2_buffer & buf)
+	{
+		VideoFrameInfo info;
+		info.sequence = buf.sequence;
+
+		if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+			info.timestamp = static_cast<std::int64_t>(buf.timestamp.tv_sec) * 1000000000 +
+				static_cast<std::int64_t>(buf.timestamp.tv_usec) * 1000;
+		}
+		else {
+			// Unknown or copied timestamps, take the time of dequeuing.
+			info.timestamp = MonotonicTime();
+		}
+
+		return info;
+	}
+
 	V4l2VideoOutputStream::V4l2VideoOutputStream(std::string devDescriptor, PVideoSink sink) :
 		VideoOutputStream(sink),
-		maxBuffers(2),
-		devDescriptor(devDescriptor)
+		deviceFormat(),
+		captureFormat(0, 0, PixelFormat::UNKNOWN),
+		captureStride(0),
+		decodeJpeg(false),
+		reactorCapture(false),
+		devDescriptor(devDescriptor),
+		v4l2_fd(-1),
+		readSequence(0),
+		sharedBuffers(false),
+		bufferQueue(std::make_shared<BufferQueue>())
 	{
+		bufferQueue->fd = -1;
+		bufferQueue->generation = 0;
+		bufferQueue->streaming = false;
 	}
 
 	V4l2VideoOutputStream::~V4l2VideoOutputStream()
@@ -44,8 +86,6 @@ namespace avdev {
             default:
                 break;
 		}
-
-		freeBuffer();
 	}
 
 	PictureFormat V4l2VideoOutputStream::getPictureFormat()
@@ -88,26 +128,136 @@ namespace avdev {
 	}
 
 	void V4l2VideoOutputStream::openInternal()
+	{
+		v4l2_fd = v4l2::openDevice(devDescriptor.c_str(), O_RDWR | O_NONBLOCK);
+
+		struct v4l2_format fmt = getRequestedFormat();
+
+		setDeviceFormat(fmt);
+		setDeviceFrameRate();
+
+		bool shareFrames = initCapture();
+
+		allocateBuffers(shareFrames);
+	}
+
+	void V4l2VideoOutputStream::closeInternal()
+	{
+		releaseBuffers();
+
+		// Frames still held by sinks release the pool later.
+		framePool.reset();
+
+		// Also called to clean up a failed reconfiguration, which may have closed the device.
+		if (v4l2_fd != -1) {
+			v4l2::closeDevice(v4l2_fd);
+			v4l2_fd = -1;
+		}
+	}
+
+	void V4l2VideoOutputStream::reconfigureInternal(bool started)
+	{
+		if (started) {
+			stopInternal();
+		}
+
+		try {
+			reconfigureDevice(started);
+		}
+		catch (...) {
+			closeInternal();
+			throw;
+		}
+	}
+
+	void V4l2VideoOutputStream::reconfigureDevice(bool started)
+	{
+		struct v4l2_format fmt = getRequestedFormat();
+
+		// Unchanged formats keep the buffers, e.g. when only the frame rate or the output format changes.
+		bool formatChanged = v4l2::ioctlDevice(v4l2_fd, VIDIOC_TRY_FMT, &fmt) == -1 ||
+			fmt.fmt.pix.width != deviceFormat.width ||
+			fmt.fmt.pix.height != deviceFormat.height ||
+			fmt.fmt.pix.pixelformat != deviceFormat.pixelformat ||
+			fmt.fmt.pix.bytesperline != deviceFormat.bytesperline ||
+			fmt.fmt.pix.sizeimage != deviceFormat.sizeimage;
+
+		if (formatChanged) {
+			// The driver refuses a new format while buffers are allocated.
+			if (!releaseBuffers()) {
+				reopen(started);
+				return;
+			}
+
+			fmt = getRequestedFormat();
+
+			setDeviceFormat(fmt);
+		}
+
+		setDeviceFrameRate();
+
+		bool shareFrames = initCapture();
+
+		if (!buffers.empty() && shareFrames != sharedBuffers && !releaseBuffers()) {
+			reopen(started);
+			return;
+		}
+
+		if (buffers.empty()) {
+			allocateBuffers(shareFrames);
+		}
+
+		if (started) {
+			startInternal();
+		}
+	}
+
+	void V4l2VideoOutputStream::reopen(bool started)
+	{
+		LOGDEV_WARN("V4l2: Buffers of %s are in use, reopening the device.", devDescriptor.c_str());
+
+		closeInternal();
+		openInternal();
+
+		if (started) {
+			startInternal();
+		}
+	}
+
+	struct v4l2_format V4l2VideoOutputStream::getRequestedFormat()
 	{
 		PictureFormat format = VideoOutputStream::getPictureFormat();
 
-		struct v4l2_pix_format * pixformat;
 		struct v4l2_format fmt = { 0 };
 		fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-		pixformat = &fmt.fmt.pix;
+		struct v4l2_pix_format * pixformat = &fmt.fmt.pix;
 		pixformat->width = format.getWidth();
 		pixformat->height = format.getHeight();
 		pixformat->pixelformat = V4l2TypeConverter::toApiType(format.getPixelFormat());
 		pixformat->field = V4L2_FIELD_NONE;
 
-		v4l2_fd = v4l2::openDevice(devDescriptor.c_str(), O_RDWR | O_NONBLOCK);
+		return fmt;
+	}
+
+	void V4l2VideoOutputStream::setDeviceFormat(struct v4l2_format & fmt)
+	{
+		struct v4l2_pix_format * pixformat = &fmt.fmt.pix;
 
 		if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_S_FMT, &fmt) == -1) {
 			throw AVdevException("V4l2: Failed setting picture format %dx%d %s.",
 				pixformat->width, pixformat->height, ToFccString(pixformat->pixelformat).c_str());
 		}
 
+		printf("V4l2: Capturing format: %dx%d %s.\n",
+			pixformat->width, pixformat->height,
+			ToFccString(pixformat->pixelformat).c_str());
+
+		deviceFormat = *pixformat;
+	}
+
+	void V4l2VideoOutputStream::setDeviceFrameRate()
+	{
 		struct v4l2_streamparm parm = { 0 };
 		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
@@ -121,9 +271,13 @@ namespace avdev {
 
 		float rate = tpf->denominator / tpf->numerator;
 		printf("V4l2: Capturing rate: %.2f fps.\n", rate);
-		printf("V4l2: Capturing format: %dx%d %s.\n",
-			pixformat->width, pixformat->height,
-			ToFccString(pixformat->pixelformat).c_str());
+	}
+
+	bool V4l2VideoOutputStream::initCapture()
+	{
+		PictureFormat format = VideoOutputStream::getPictureFormat();
+
+		const struct v4l2_pix_format * pixformat = &deviceFormat;
 
 		/*
 		 * Since video4linux adjusts the settings to its needs, if they are
@@ -132,23 +286,121 @@ namespace avdev {
 		PixelFormat pixelFormat = V4l2TypeConverter::toPixelFormat(pixformat->pixelformat);
 		PictureFormat outputFormat(pixformat->width, pixformat->height, pixelFormat);
 
-		if (format != outputFormat) {
+		captureFormat = outputFormat;
+		captureStride = pixformat->bytesperline;
+
+		// Compressed frames are passed to the sink without decoding and conversion.
+		bool passthrough = getCompressedPassthrough() && IsCompressedFormat(pixelFormat);
+
+		decodeJpeg = !passthrough && (pixelFormat == PixelFormat::MJPG || pixelFormat == PixelFormat::JPEG);
+
+		colorSpace = V4l2TypeConverter::toColorSpace(*pixformat);
+
+		if (decodeJpeg) {
+			if (IsCompressedFormat(format.getPixelFormat())) {
+				format.setPixelFormat(PixelFormat::RGB24);
+			}
+
+			// Frames for a smaller output are decoded with the scaled inverse DCT,
+			// the converter only resizes the remainder. It scales to RGB24, BGR24
+			// and RGB32, other formats, e.g. GREY, only at the decoded size.
+			unsigned scale = 1;
+
+			if (format.getWidth() > 0 && format.getHeight() > 0) {
+				scale = JpegDecoder::selectScale(captureFormat.getWidth(), captureFormat.getHeight(),
+					format.getWidth(), format.getHeight());
+			}
+
+			jpegDecoder.setScale(scale);
+
+			captureFormat.setWidth(JpegDecoder::scaleSize(captureFormat.getWidth(), scale));
+			captureFormat.setHeight(JpegDecoder::scaleSize(captureFormat.getHeight(), scale));
+
+			// The decoded frames are the source of the conversion. Unscaled RGB24
+			// is decoded directly, all other formats are converted from the YCbCr
+			// planes, skipping the color conversion of the decoder.
+			bool decodeRgb = (format.getPixelFormat() == PixelFormat::RGB24 &&
+				format.getWidth() == captureFormat.getWidth() && format.getHeight() == captureFormat.getHeight());
+
+			jpegDecoder.setOutputFormat(decodeRgb ? PixelFormat::RGB24 : PixelFormat::I420);
+
+			captureFormat.setPixelFormat(jpegDecoder.getOutputFormat());
+			captureStride = 0;
+
+			// JFIF YCbCr is full range BT.601, regardless of the colorspace reported by the driver.
+			colorSpace = ColorSpace(YuvMatrix::BT601, YuvRange::Full);
+		}
+
+		// Drivers may pad the rows for alignment, which the sink does not expect.
+		bool padded = !IsCompressedFormat(captureFormat.getPixelFormat()) && captureStride != 0 &&
+			captureStride != GetPlaneRowSize(captureFormat, 0);
+
+		if (!passthrough && (format != captureFormat || !getOrientation().isIdentity() || padded)) {
             LOGDEV_DEBUG("Format: User [%s] <> Device [%s]", format.toString().c_str(), outputFormat.toString().c_str());
 
-            converter = std::make_shared<avdev::PixelFormatConverter>();
-            converter->init(outputFormat, format);
+			// A reconfigured stream keeps its converter.
+			if (!converter) {
+				converter = std::make_shared<avdev::PixelFormatConverter>();
+			}
+
+            converter->init(captureFormat, format, colorSpace);
+            converter->setThreadCount(getConversionThreads());
+            converter->setOrientation(getOrientation());
+		}
+		else {
+			converter.reset();
 		}
 
-		setPictureFormat(outputFormat);
+		// The requested picture format is kept, a reopened device is asked for it again.
+		setOutputFormat(converter ? converter->getOutputFormat() : captureFormat);
 
-		initBuffer(pixformat->sizeimage * 2);
+		// Pooled frames hold converted frames and copies of captured or decoded frames for the delivery queue.
+		// Compressed frames passed through are at most as large as the device buffers.
+		std::size_t frameSize = pixformat->sizeimage;
+
+		if (!IsCompressedFormat(captureFormat.getPixelFormat())) {
+			frameSize = std::max(frameSize, GetFrameSize(captureFormat));
+		}
+
+		if (converter) {
+			frameSize = std::max(frameSize, GetFrameSize(converter->getOutputFormat()));
+		}
+
+		initFramePool(frameSize);
+
+		// Frames which are written unchanged can be shared without copying.
+		auto sharingSink = std::dynamic_pointer_cast<DmaBufVideoSink>(sink);
+
+		return sharingSink && !decodeJpeg && !converter;
 	}
 
-	void V4l2VideoOutputStream::closeInternal()
+	void V4l2VideoOutputStream::allocateBuffers(bool shareFrames)
+	{
+		initBuffer(deviceFormat.sizeimage, shareFrames);
+
+		sharedBuffers = shareFrames;
+
+		dmaBufSink.reset();
+
+		if (shareFrames && ioMethod == v4l2::IOMethod::MMAP) {
+			if (exportBuffers()) {
+				dmaBufSink = std::dynamic_pointer_cast<DmaBufVideoSink>(sink);
+			}
+			else {
+				LOGDEV_WARN("V4l2: Buffer export not supported by %s, frames are copied.", devDescriptor.c_str());
+			}
+		}
+
+		setOwnSinkShared(dmaBufSink != nullptr);
+	}
+
+	bool V4l2VideoOutputStream::releaseBuffers()
 	{
 		switch (ioMethod) {
 			case v4l2::IOMethod::READ:
-				free(getBuffer(0));
+				for (unsigned i = 0; i < buffers.size(); ++i) {
+					free(getBuffer(i));
+				}
 				break;
 
 			case v4l2::IOMethod::MMAP:
@@ -160,28 +412,63 @@ namespace avdev {
 				break;
 
 			case v4l2::IOMethod::USERPTR:
-				for (unsigned i = 0; i < buffers.size(); ++i) {
-					free(getBuffer(i));
-				}
+				// The buffers are kept in the pool for the next capture.
 				break;
 		}
 
+		closeExportedBuffers();
+		dmaBufSink.reset();
+		setOwnSinkShared(false);
+
+		bool requested = !buffers.empty() && ioMethod != v4l2::IOMethod::READ;
+
+		{
+			// Frames still held belong to the former buffers.
+			std::unique_lock<std::mutex> lock(bufferQueue->mutex);
+			bufferQueue->generation++;
+			bufferQueue->held.clear();
+		}
+
 		buffers.clear();
 		buffers.shrink_to_fit();
 
-		v4l2::closeDevice(v4l2_fd);
+		if (requested) {
+			struct v4l2_requestbuffers req = { 0 };
+			req.count = 0;
+			req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			req.memory = getMemoryType();
+
+			// Fails while frames exported as dmabuf are still held.
+			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_REQBUFS, &req) == -1) {
+				return false;
+			}
+		}
+
+		return true;
 	}
 
 	void V4l2VideoOutputStream::startInternal()
 	{
-		if (ioMethod == v4l2::IOMethod::MMAP) {
+		if (ioMethod != v4l2::IOMethod::READ) {
+			std::unique_lock<std::mutex> lock(bufferQueue->mutex);
+
 			for (unsigned i = 0; i < buffers.size(); ++i) {
+				if (bufferQueue->held.count(i) != 0) {
+					// Still held by the dmabuf sink, queued on release.
+					continue;
+				}
+
 				struct v4l2_buffer buf = { 0 };
 
 				buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				buf.memory = V4L2_MEMORY_MMAP;
+				buf.memory = getMemoryType();
 				buf.index = i;
 
+				if (ioMethod == v4l2::IOMethod::USERPTR) {
+					buf.m.userptr = reinterpret_cast<unsigned long>(getBuffer(i));
+					buf.length = getBufferSize(i);
+				}
+
 				if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QBUF, &buf) == -1) {
 					throw AVdevException("V4l2: Failed querying buffer %d for %s.", i, devDescriptor.c_str());
 				}
@@ -192,16 +479,70 @@ namespace avdev {
 			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_STREAMON, &type) == -1) {
 				throw AVdevException("V4l2: Failed starting stream for %s.", devDescriptor.c_str());
 			}
+
+			bufferQueue->fd = v4l2_fd;
+			bufferQueue->streaming = true;
 		}
 
-		startThread();
+		if (decodeJpeg && getDecodeThreads() > 1) {
+			parallelDecoder.reset(new ParallelJpegDecoder(getDecodeThreads(), jpegDecoder.getOutputFormat(),
+				jpegDecoder.getScale(), [this](const std::uint8_t * data, size_t length, const VideoFrameInfo & info) {
+					writeDecodedFrame(data, length, info);
+				}));
+		}
+
+		// Devices restart counting with each stream.
+		readSequence = 0;
+		resetFrameSequence();
+
+		startDelivery();
+
+		reactorCapture = getSharedCapture();
+
+		if (reactorCapture) {
+			CaptureReactor::instance().add(v4l2_fd, [this]() {
+				if (captureFrame() == -1) {
+					printf("V4l2: Failed capturing a frame from %s.\n", devDescriptor.c_str());
+					return false;
+				}
+				return true;
+			});
+		}
+		else {
+			startThread();
+		}
 	}
 
 	void V4l2VideoOutputStream::stopInternal()
 	{
-		stopThreadAndWait();
+		if (reactorCapture) {
+			CaptureReactor::instance().remove(v4l2_fd);
+		}
+		else {
+			stopThreadAndWait();
+		}
+
+		if (parallelDecoder) {
+			std::uint64_t dropped = parallelDecoder->getDroppedFrames();
+
+			if (dropped > 0) {
+				LOGDEV_WARN("V4l2: Decoder overflow, dropped %llu frames from %s.",
+					static_cast<unsigned long long>(dropped), devDescriptor.c_str());
+			}
+
+			// Delivers the frames in flight.
+			parallelDecoder.reset();
+		}
+
+		stopDelivery();
 
 		if (ioMethod != v4l2::IOMethod::READ) {
+			{
+				// Frames released from now on are queued by the next start.
+				std::unique_lock<std::mutex> lock(bufferQueue->mutex);
+				bufferQueue->streaming = false;
+			}
+
 			enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			v4l2::ioctlDevice(v4l2_fd, VIDIOC_STREAMOFF, &type);
 		}
@@ -244,33 +585,25 @@ namespace avdev {
 	int V4l2VideoOutputStream::captureFrame()
 	{
 		if (ioMethod == v4l2::IOMethod::READ) {
-			if (read(v4l2_fd, getBuffer(0), getBufferSize(0)) == -1) {
+			ssize_t length = read(v4l2_fd, getBuffer(0), getBufferSize(0));
+
+			if (length == -1) {
 				if (errno == EAGAIN)
 					return 0;
 				else
 					return -1;
 			}
 
-			if (converter) {
-                PictureFormat format = converter->getOutputFormat();
-                unsigned width = format.getWidth();
-                unsigned height = format.getHeight();
-                unsigned size = width * height;
-
-                converter->convert(getBuffer(0), buffer.data(), static_cast<int>(size));
-
-                size_t frameSize = size * format.getBytesPerPixel();
+			VideoFrameInfo info;
+			info.timestamp = MonotonicTime();
+			info.sequence = readSequence++;
 
-                writeVideoFrame(buffer.data(), frameSize);
-            }
-            else {
-                writeVideoFrame(getBuffer(0), getBufferSize(0));
-            }
+			processFrame(getBuffer(0), static_cast<size_t>(length), info);
 		}
-		else if (ioMethod == v4l2::IOMethod::MMAP) {
+		else {
 			struct v4l2_buffer buf = { 0 };
 			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			buf.memory = V4L2_MEMORY_MMAP;
+			buf.memory = getMemoryType();
 
 			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_DQBUF, &buf) == -1) {
 				if (errno == EAGAIN)
@@ -279,35 +612,37 @@ namespace avdev {
 					return -1;
 			}
 
-			/*
-			std::uint8_t * output;
-			size_t outputSize = buf.bytesused;
+			if (getLatestFrameOnly()) {
+				// Requeue the older of the ready buffers without processing them.
+				struct v4l2_buffer next = buf;
 
-			try {
-				jpegDecoder.transform(getBuffer(buf.index), buf.bytesused, &output, &outputSize);
-			}
-			catch (AVdevException & e) {
-				printf("ERROR: %s \n", e.what());
+				while (v4l2::ioctlDeviceNoWait(v4l2_fd, VIDIOC_DQBUF, &next) != -1) {
+					if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QBUF, &buf) == -1) {
+						printf("V4l2: Failed to enqueue buffer.\n");
+					}
+
+					buf = next;
+				}
 			}
 
-			writeVideoFrame(output, outputSize);
-            */
+			VideoFrameInfo info = GetFrameInfo(buf);
 
-			if (converter) {
-                PictureFormat format = converter->getOutputFormat();
-                unsigned width = format.getWidth();
-                unsigned height = format.getHeight();
-                unsigned size = width * height;
+			if (dmaBufSink) {
+				// Attached sinks read the mapped buffer before it is handed out.
+				if (!IsCompressedFormat(captureFormat.getPixelFormat())) {
+					writeAttachedSinks(MakeFrameView(captureFormat, getBuffer(buf.index), captureStride), captureFormat,
+						colorSpace, info);
+				}
 
-                converter->convert(getBuffer(buf.index), buffer.data(), static_cast<int>(size));
+				if (hasAttachedSinks(captureFormat)) {
+					writeSharedFrameCopy(buf, info);
+				}
 
-                size_t frameSize = size * format.getBytesPerPixel();
+				writeDmaBufFrame(buf, info);
+				return 1;
+			}
 
-                writeVideoFrame(buffer.data(), frameSize);
-            }
-            else {
-                writeVideoFrame(getBuffer(buf.index), buf.bytesused);
-            }
+			processFrame(getBuffer(buf.index), buf.bytesused, info);
 
 			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_QBUF, &buf) == -1) {
 				printf("V4l2: Failed to enqueue buffer.\n");
@@ -317,7 +652,7 @@ namespace avdev {
 		return 1;
 	}
 
-	void V4l2VideoOutputStream::initBuffer(unsigned int pictureSize)
+	void V4l2VideoOutputStream::initBuffer(unsigned int pictureSize, bool exportable)
 	{
 		struct v4l2_capability cap;
 
@@ -325,9 +660,13 @@ namespace avdev {
 			throw AVdevException("V4l2: Failed to query device capabilities: %s.", devDescriptor.c_str());
 		}
 
-		if (cap.capabilities & V4L2_CAP_STREAMING) {
+		if ((cap.capabilities & V4L2_CAP_STREAMING) && !exportable && initUserBuffers(pictureSize)) {
+			// The device writes into our own aligned memory. Exported buffers have to be mapped.
+			ioMethod = v4l2::IOMethod::USERPTR;
+		}
+		else if (cap.capabilities & V4L2_CAP_STREAMING) {
 			struct v4l2_requestbuffers req = { 0 };
-			req.count = maxBuffers;
+			req.count = getBufferCount();
 			req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			req.memory = V4L2_MEMORY_MMAP;
 
@@ -381,8 +720,206 @@ namespace avdev {
 		else {
 			throw AVdevException("V4l2: Failed to determine IO method for %s.", devDescriptor.c_str());
 		}
+	}
+
+	bool V4l2VideoOutputStream::initUserBuffers(size_t size)
+	{
+		struct v4l2_requestbuffers req = { 0 };
+		req.count = getBufferCount();
+		req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		req.memory = V4L2_MEMORY_USERPTR;
+
+		if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_REQBUFS, &req) == -1 || req.count == 0) {
+			// Not supported by the driver.
+			return false;
+		}
+
+		bufferPool.reserve(req.count, size);
+
+		buffers.resize(req.count);
+
+		for (unsigned i = 0; i < req.count; ++i) {
+			buffers[i] = std::make_pair(bufferPool.getBuffer(i), bufferPool.getBufferSize(i));
+		}
+
+		return true;
+	}
+
+	enum v4l2_memory V4l2VideoOutputStream::getMemoryType() const
+	{
+		return (ioMethod == v4l2::IOMethod::USERPTR) ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
+	}
+
+	void V4l2VideoOutputStream::processFrame(std::uint8_t * data, size_t length, const VideoFrameInfo & info)
+	{
+		// Passed through frames keep the JPEG capture format.
+		bool jpeg = decodeJpeg || captureFormat.getPixelFormat() == PixelFormat::MJPG ||
+			captureFormat.getPixelFormat() == PixelFormat::JPEG;
+
+		if (jpeg && !JpegDecoder::isComplete(data, length)) {
+			// Drop truncated frames before spending time on decoding or storing them.
+			return;
+		}
+
+		if (decodeJpeg) {
+			if (parallelDecoder) {
+				// The frame is copied, the capture buffer can be requeued.
+				parallelDecoder->push(data, length, info);
+				return;
+			}
+
+			Bytes decoded;
+			size_t decodedSize;
+
+			try {
+				jpegDecoder.transform(data, length, &decoded, &decodedSize);
+			}
+			catch (AVdevException & e) {
+				LOGDEV_WARN("V4l2: Dropped frame from %s: %s", devDescriptor.c_str(), e.what());
+				return;
+			}
+
+			writeDecodedFrame(decoded, decodedSize, info);
+		}
+		else {
+			if (converter) {
+				writeConvertedFrame(data, info);
+			}
+			else {
+				writeVideoFrame(data, length, captureFormat, info);
+			}
+
+			// Compressed frames have no planes to convert for the attached sinks.
+			if (!IsCompressedFormat(captureFormat.getPixelFormat())) {
+				writeAttachedSinks(MakeFrameView(captureFormat, data, captureStride), captureFormat, colorSpace, info);
+			}
+		}
+	}
+
+	void V4l2VideoOutputStream::writeDecodedFrame(const std::uint8_t * data, size_t length, const VideoFrameInfo & info)
+	{
+		if (length != GetFrameSize(captureFormat)) {
+			LOGDEV_WARN("V4l2: Dropped frame from %s with unexpected size.", devDescriptor.c_str());
+			return;
+		}
+
+		if (converter) {
+			writeConvertedFrame(data, info);
+		}
+		else {
+			writeVideoFrame(data, length, captureFormat, info);
+		}
+
+		writeAttachedSinks(MakeFrameView(captureFormat, data), captureFormat, colorSpace, info);
+	}
+
+	void V4l2VideoOutputStream::writeConvertedFrame(const std::uint8_t * data, const VideoFrameInfo & info)
+	{
+		const PictureFormat & format = converter->getOutputFormat();
+		size_t frameSize = GetFrameSize(format);
+
+		if (converter->isZeroCopy() && (captureStride == 0 || captureStride == GetPlaneRowSize(captureFormat, 0))) {
+			// The converted frame is the start of the captured frame.
+			writeVideoFrame(data, frameSize, format, info);
+			return;
+		}
+
+		PVideoFrame frame = acquireVideoFrame();
+
+		if (!frame) {
+			// All frames are held by the sinks or the delivery queue.
+			return;
+		}
+
+		frame->setFormat(format, frameSize);
+		frame->setInfo(info);
+
+		converter->convert(MakeFrameView(captureFormat, data, captureStride), frame->getView());
+
+		writeVideoFrame(std::move(frame));
+	}
+
+	V4l2VideoOutputStream::ExportedBuffers::~ExportedBuffers()
+	{
+		for (int fd : fds) {
+			::close(fd);
+		}
+	}
+
+	bool V4l2VideoOutputStream::exportBuffers()
+	{
+		exportedBuffers = std::make_shared<ExportedBuffers>();
+
+		for (unsigned i = 0; i < buffers.size(); ++i) {
+			struct v4l2_exportbuffer expbuf = { 0 };
+			expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			expbuf.index = i;
+			expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+			if (v4l2::ioctlDevice(v4l2_fd, VIDIOC_EXPBUF, &expbuf) == -1) {
+				closeExportedBuffers();
+				return false;
+			}
+
+			exportedBuffers->fds.push_back(expbuf.fd);
+		}
+
+		return true;
+	}
+
+	void V4l2VideoOutputStream::closeExportedBuffers()
+	{
+		// Frames still held by the dmabuf sink keep their descriptors open.
+		exportedBuffers.reset();
+	}
+
+	void V4l2VideoOutputStream::writeSharedFrameCopy(const struct v4l2_buffer & buf, const VideoFrameInfo & info)
+	{
+		PVideoFrame frame = acquireVideoFrame();
+
+		if (!frame || frame->getCapacity() < buf.bytesused) {
+			return;
+		}
+
+		frame->setFormat(captureFormat, buf.bytesused);
+		frame->setInfo(info);
+
+		std::memcpy(frame->getData(), getBuffer(buf.index), buf.bytesused);
+
+		writeVideoFrame(std::move(frame));
+	}
+
+	void V4l2VideoOutputStream::writeDmaBufFrame(const struct v4l2_buffer & buf, const VideoFrameInfo & info)
+	{
+		DmaBufFrame frame = { exportedBuffers->fds[buf.index], 0, buf.bytesused, captureStride, captureFormat,
+			countDroppedFrames(info) };
+
+		std::shared_ptr<BufferQueue> queue = bufferQueue;
+		std::shared_ptr<ExportedBuffers> exported = exportedBuffers;
+		struct v4l2_buffer requeue = buf;
+		unsigned generation;
+
+		{
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			generation = queue->generation;
+			queue->held.insert(buf.index);
+		}
+
+		dmaBufSink->writeDmaBufFrame(frame, [queue, exported, requeue, generation]() mutable {
+			std::unique_lock<std::mutex> lock(queue->mutex);
+
+			if (queue->generation == generation) {
+				queue->held.erase(requeue.index);
+
+				// Released while stopped, the buffer is queued by the next start.
+				if (queue->streaming && v4l2::ioctlDevice(queue->fd, VIDIOC_QBUF, &requeue) == -1) {
+					printf("V4l2: Failed to enqueue buffer.\n");
+				}
+			}
 
-		Stream::initBuffer(pictureSize * 2);
+			// The descriptor is valid until the frame is released.
+			exported.reset();
+		});
 	}
 
 	std::uint8_t * V4l2VideoOutputStream::getBuffer(std::uint8_t index)
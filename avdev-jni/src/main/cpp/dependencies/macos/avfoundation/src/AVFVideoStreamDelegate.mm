@@ -19,6 +19,8 @@
 #import "PixelFormatConverter.h"
 #import "Log.h"
 
+#include <algorithm>
+
 @implementation AVFVideoStreamDelegate
 
 - (id) init
@@ -149,7 +151,7 @@
 	if (format != outputFormat) {
 		LOGDEV_DEBUG("Format: Device [%s] <> User [%s]", outputFormat.toString().c_str(), format.toString().c_str());
 		
-		unsigned size = format.getWidth() * format.getHeight() * format.getBytesPerPixel();
+		unsigned size = avdev::GetFrameSize(format);
 		
 		[self initFrameBuffer: size];
 		
@@ -226,15 +228,31 @@
 		CVPixelBufferLockBaseAddress(imageBuffer, kCVPixelBufferLock_ReadOnly);
 		
 		uint8_t * baseAddress = reinterpret_cast<uint8_t *>(CVPixelBufferGetBaseAddress(imageBuffer));
-		size_t width = CVPixelBufferGetWidth(imageBuffer);
 		size_t height = CVPixelBufferGetHeight(imageBuffer);
 		size_t stride = CVPixelBufferGetBytesPerRow(imageBuffer);
 		size_t frameSize = stride * height;
 
 		if (converter) {
-			converter->convert(baseAddress, buffer.data(), static_cast<int>(width * height));
+			avdev::ConstFrameView src;
+
+			if (CVPixelBufferIsPlanar(imageBuffer)) {
+				size_t planes = std::min<size_t>(CVPixelBufferGetPlaneCount(imageBuffer), avdev::ConstFrameView::MaxPlanes);
+
+				for (size_t i = 0; i < planes; i++) {
+					src.data[i] = reinterpret_cast<const uint8_t *>(CVPixelBufferGetBaseAddressOfPlane(imageBuffer, i));
+					src.stride[i] = CVPixelBufferGetBytesPerRowOfPlane(imageBuffer, i);
+				}
+			}
+			else {
+				src.data[0] = baseAddress;
+				src.stride[0] = stride;
+			}
+
+			const avdev::PictureFormat & format = converter->getOutputFormat();
+
+			converter->convert(src, avdev::MakeFrameView(format, buffer.data()));
 			
-			frameSize = width * height * converter->getOutputFormat().getBytesPerPixel();
+			frameSize = avdev::GetFrameSize(format);
 			baseAddress = buffer.data();
 		}
 		
@@ -39,6 +39,14 @@ JNIEXPORT jobject JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_getPic
 JNIEXPORT jobject JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_getCameraControls
   (JNIEnv *, jobject);
 
+/*
+ * Class:     org_lecturestudio_avdev_VideoCaptureDevice
+ * Method:    getFrameRates
+ * Signature: (Lorg/lecturestudio/avdev/PictureFormat;)[F
+ */
+JNIEXPORT jfloatArray JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_getFrameRates
+  (JNIEnv *, jobject, jobject);
+
 /*
  * Class:     org_lecturestudio_avdev_VideoCaptureDevice
  * Method:    setPictureControlAutoMode
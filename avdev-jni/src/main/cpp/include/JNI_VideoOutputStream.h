@@ -0,0 +1,29 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class org_lecturestudio_avdev_VideoOutputStream */
+
+#ifndef _Included_org_lecturestudio_avdev_VideoOutputStream
+#define _Included_org_lecturestudio_avdev_VideoOutputStream
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     org_lecturestudio_avdev_VideoOutputStream
+ * Method:    reconfigure
+ * Signature: (Lorg/lecturestudio/avdev/PictureFormat;F)V
+ */
+JNIEXPORT void JNICALL Java_org_lecturestudio_avdev_VideoOutputStream_reconfigure
+  (JNIEnv *, jobject, jobject, jfloat);
+
+/*
+ * Class:     org_lecturestudio_avdev_VideoOutputStream
+ * Method:    getReconfigureLatency
+ * Signature: ()F
+ */
+JNIEXPORT jfloat JNICALL Java_org_lecturestudio_avdev_VideoOutputStream_getReconfigureLatency
+  (JNIEnv *, jobject);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
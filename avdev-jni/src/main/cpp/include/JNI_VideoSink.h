@@ -17,7 +17,11 @@ namespace avdev
 			JNI_VideoSink(JNIEnv * env, const jni::JavaGlobalRef<jobject> & sink);
 			~JNI_VideoSink();
 
+			using VideoSink::writeVideoFrame;
+
 			void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format);
+			void writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+				const VideoFrameInfo & info);
 
 		private:
 			class JavaVideoSinkClass : public jni::JavaClass
@@ -26,6 +30,7 @@ namespace avdev
 					explicit JavaVideoSinkClass(JNIEnv * env);
 
 					jmethodID write;
+					jmethodID writeWithInfo;
 			};
 
 		private:
@@ -115,6 +115,35 @@ JNIEXPORT jobject JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_getCam
 	return nullptr;
 }
 
+JNIEXPORT jfloatArray JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_getFrameRates
+(JNIEnv * env, jobject caller, jobject format)
+{
+	VideoCaptureDevice * device = GetHandle<VideoCaptureDevice>(env, caller);
+	CHECK_HANDLEV(device, nullptr);
+
+	try {
+		jni::JavaLocalRef<jobject> javaRef = jni::JavaLocalRef<jobject>(env, format);
+
+		std::vector<float> frameRates = device->getFrameRates(jni::PictureFormat::toNative(env, javaRef));
+		jsize count = static_cast<jsize>(frameRates.size());
+		jfloatArray rateArray = env->NewFloatArray(count);
+
+		if (rateArray != nullptr) {
+			env->SetFloatArrayRegion(rateArray, 0, count, frameRates.data());
+		}
+
+		return rateArray;
+	}
+	catch (AVdevException & ex) {
+		env->Throw(jni::JavaRuntimeException(env, ex.what()));
+	}
+	catch (...) {
+		ThrowCxxJavaException(env);
+	}
+
+	return nullptr;
+}
+
 JNIEXPORT void JNICALL Java_org_lecturestudio_avdev_VideoCaptureDevice_setPictureControlAutoMode
 (JNIEnv * env, jobject caller, jobject type, jboolean autoMode)
 {
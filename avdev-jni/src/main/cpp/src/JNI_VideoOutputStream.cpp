@@ -0,0 +1,36 @@
+#include "AVdevException.h"
+#include "VideoOutputStream.h"
+#include "api/PictureFormat.h"
+#include "JNI_VideoOutputStream.h"
+#include "JavaRuntimeException.h"
+#include "JavaUtils.h"
+
+using namespace avdev;
+
+JNIEXPORT void JNICALL Java_org_lecturestudio_avdev_VideoOutputStream_reconfigure
+(JNIEnv * env, jobject caller, jobject format, jfloat frameRate)
+{
+	VideoOutputStream * stream = GetHandle<VideoOutputStream>(env, caller);
+	CHECK_HANDLE(stream);
+
+	try {
+		jni::JavaLocalRef<jobject> javaRef = jni::JavaLocalRef<jobject>(env, format);
+
+		stream->reconfigure(jni::PictureFormat::toNative(env, javaRef), static_cast<float>(frameRate));
+	}
+	catch (AVdevException & ex) {
+		env->Throw(jni::JavaRuntimeException(env, ex.what()));
+	}
+	catch (...) {
+		ThrowCxxJavaException(env);
+	}
+}
+
+JNIEXPORT jfloat JNICALL Java_org_lecturestudio_avdev_VideoOutputStream_getReconfigureLatency
+(JNIEnv * env, jobject caller)
+{
+	VideoOutputStream * stream = GetHandle<VideoOutputStream>(env, caller);
+	CHECK_HANDLEV(stream, 0);
+
+	return static_cast<jfloat>(stream->getReconfigureLatency());
+}
@@ -13,20 +13,47 @@ namespace avdev
 
 	JNI_VideoSink::~JNI_VideoSink()
 	{
-		buffer = nullptr;
+		if (buffer != nullptr) {
+			AttachCurrentThread()->DeleteGlobalRef(buffer);
+			buffer = nullptr;
+		}
 	}
 
 	void JNI_VideoSink::writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format)
+	{
+		writeVideoFrame(data, length, format, VideoFrameInfo());
+	}
+
+	void JNI_VideoSink::writeVideoFrame(const std::uint8_t * data, size_t length, const PictureFormat & format,
+		const VideoFrameInfo & info)
 	{
 		JNIEnv * env = AttachCurrentThread();
 		jsize size = static_cast<jsize>(length);
 
-		if (buffer == nullptr) {
-			buffer = reinterpret_cast<jbyteArray>(env->NewGlobalRef(env->NewByteArray(size * 2)));
+		if (buffer == nullptr || env->GetArrayLength(buffer) < size) {
+			// Larger frames, e.g. after a reconfiguration, need a larger array.
+			if (buffer != nullptr) {
+				env->DeleteGlobalRef(buffer);
+				buffer = nullptr;
+			}
+
+			jbyteArray array = env->NewByteArray(size * 2);
+
+			if (array == nullptr) {
+				// Drop the frame, the OutOfMemoryError must not reach the capture thread.
+				env->ExceptionClear();
+				return;
+			}
+
+			buffer = reinterpret_cast<jbyteArray>(env->NewGlobalRef(array));
+			env->DeleteLocalRef(array);
 		}
 
 		env->SetByteArrayRegion(buffer, 0, size, (jbyte *) data);
-		env->CallVoidMethod(sink, javaClass->write, buffer, size);
+
+		// Primitive arguments, no Java objects are allocated per frame.
+		env->CallVoidMethod(sink, javaClass->writeWithInfo, buffer, size, static_cast<jlong>(info.timestamp),
+			static_cast<jlong>(info.sequence), static_cast<jint>(info.dropped));
 	}
 
 	JNI_VideoSink::JavaVideoSinkClass::JavaVideoSinkClass(JNIEnv* env)
@@ -34,5 +61,6 @@ namespace avdev
 		jclass cls = FindClass(env, PKG "VideoSink");
 
 		write = GetMethod(env, cls, "write", "([BI)V");
+		writeWithInfo = GetMethod(env, cls, "write", "([BIJJI)V");
 	}
 }
\ No newline at end of file
@@ -58,6 +58,7 @@ public class PictureFormat {
 		/** 12  YUV 4:2:0      */		I420	(FourCC("I420")),
 		/** 16  YUV 4:2:2      */		YUYV	(FourCC("YUYV")),
 		/** 16  YUV 4:2:2      */		UYVY	(FourCC("UYVY")),
+		/** 16  YVU 4:2:2      */		YVYU	(FourCC("YVYU")),
 		/** 16  YVU 422 planar */		YUV422P	(FourCC("I422")),
 		/** 16  YVU 411 planar */		YUV411P	(FourCC("I411")),
 		/** 12  YUV 4:1:1      */		Y41P	(FourCC("Y41P")),
@@ -25,6 +25,7 @@ public class VideoCaptureDevice extends Device {
 	native public List<PictureFormat> getPictureFormats();
 	native public List<PictureControl> getPictureControls();
 	native public List<CameraControl> getCameraControls();
+	native public float[] getFrameRates(PictureFormat format);
 
 	native public void setPictureControlAutoMode(PictureControlType type, boolean auto);
 	native public boolean getPictureControlAutoMode(PictureControlType type);
@@ -21,5 +21,9 @@ public class VideoOutputStream extends VideoStream {
 	private VideoOutputStream() {
 		
 	}
+
+	native public void reconfigure(PictureFormat format, float frameRate) throws Exception;
+
+	native public float getReconfigureLatency();
 	
 }
@@ -21,5 +21,20 @@ import java.io.IOException;
 public interface VideoSink {
 
 	void write(byte[] data, int length) throws IOException;
+
+	/**
+	 * Receives a frame with its capture metadata. By default the metadata is
+	 * discarded and the frame is passed to {@link #write(byte[], int)}.
+	 *
+	 * @param data      the frame data.
+	 * @param length    the length of the frame in bytes.
+	 * @param timestamp the capture time in nanoseconds on the monotonic clock,
+	 *                  comparable to {@link System#nanoTime()}, or 0 if unknown.
+	 * @param sequence  the frame number counted by the device.
+	 * @param dropped   the number of frames lost since the previous frame.
+	 */
+	default void write(byte[] data, int length, long timestamp, long sequence, int dropped) throws IOException {
+		write(data, length);
+	}
 	
 }